@@ -0,0 +1,118 @@
+#include <serialization/json_serializer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+/**
+ * Per-message latency of read_json (errors thrown and caught) and try_from_json (errors returned)
+ * on a corpus where 5% of the messages are malformed in various ways.
+ */
+
+struct order_line
+{
+    std::int64_t _id;
+    std::string _sku;
+    std::string _label;
+    double _price;
+    int _quantity;
+    std::vector<std::string> _tags;
+};
+
+template<typename T>
+struct registry {};
+
+template<>
+struct registry<order_line>
+{
+    static constexpr auto reflector = refl::refl<order_line>("order_line")
+            .add("id", &order_line::_id)
+            .add("sku", &order_line::_sku)
+            .add("label", &order_line::_label)
+            .add("price", &order_line::_price)
+            .add("quantity", &order_line::_quantity)
+            .add("tags", &order_line::_tags);
+};
+
+namespace
+{
+    constexpr std::size_t corpus_size = 200000;
+    constexpr std::size_t malformed_every = 20;
+
+    auto make_corpus() -> std::vector<std::string> {
+        std::vector<std::string> corpus;
+        corpus.reserve(corpus_size);
+        order_line line{._id = 0, ._sku = "SKU-000000", ._label = "", ._price = 0, ._quantity = 0, ._tags = {"fresh", "bulk", "promo"}};
+        for(std::size_t i = 0; i < corpus_size; ++i)
+        {
+            line._id = static_cast<std::int64_t>(i);
+            line._label = "order line number " + std::to_string(i);
+            line._price = static_cast<double>(i % 10000) / 100.0;
+            line._quantity = static_cast<int>(i % 17);
+            auto message = to_json<order_line, registry>(line);
+            if(i % malformed_every == 0)
+            {
+                switch(i / malformed_every % 4)
+                {
+                    case 0: message.resize(message.size() / 2); break;                                     // truncated
+                    case 1: message.replace(message.find("\"id\":") + 5, 1, "\"x\","); break;              // type mismatch
+                    case 2: message.replace(message.find("\"sku\""), 5, "\"skv\""); break;                 // missing field
+                    default: message.replace(message.find("\"fresh\""), 7, "fresh"); break;                // syntax error
+                }
+            }
+            corpus.push_back(std::move(message));
+        }
+        return corpus;
+    }
+
+    template<typename Decode>
+    auto measure(char const* const name, std::vector<std::string> const& corpus, Decode&& decode) -> void {
+        std::vector<double> latencies;
+        latencies.reserve(corpus.size());
+        std::size_t failures = 0;
+        for(auto const& message : corpus)
+        {
+            auto const start = std::chrono::steady_clock::now();
+            failures += decode(message) ? 0 : 1;
+            std::chrono::duration<double, std::nano> const elapsed = std::chrono::steady_clock::now() - start;
+            latencies.push_back(elapsed.count());
+        }
+
+        double total = 0;
+        for(auto const latency : latencies)
+        {
+            total += latency;
+        }
+        std::ranges::sort(latencies);
+        auto const percentile = [&](double const p) {
+            return latencies[static_cast<std::size_t>(p * static_cast<double>(latencies.size() - 1))];
+        };
+        std::printf("%-14s mean %7.0f ns  p50 %7.0f ns  p99 %7.0f ns  p99.9 %7.0f ns  (%zu failures)\n",
+                    name, total / static_cast<double>(latencies.size()), percentile(0.5), percentile(0.99), percentile(0.999), failures);
+    }
+}
+
+int main()
+{
+    auto const corpus = make_corpus();
+    for(int round = 0; round < 2; ++round)
+    {
+        measure("read_json", corpus, [](std::string const& message) {
+            try
+            {
+                return read_json<order_line, registry>(message)._quantity >= 0;
+            }
+            catch(std::exception const&)
+            {
+                return false;
+            }
+        });
+        measure("try_from_json", corpus, [](std::string const& message) {
+            return try_from_json<order_line, registry>(message).has_value();
+        });
+    }
+    return 0;
+}
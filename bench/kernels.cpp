@@ -0,0 +1,93 @@
+#include <serialization/string_kernels.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+/**
+ * Compare the scalar, SSE2 and AVX2 scanning kernels on payload shaped buffers:
+ * long string values with rare escapes, and indentation-heavy whitespace runs.
+ */
+
+using namespace dori::json::kernels;
+
+namespace
+{
+    // Scan the whole buffer the way the reader and writer do: stop at each hit and resume after it
+    template<typename Kernel>
+    auto scan(std::string const& buffer, Kernel kernel) -> std::size_t {
+        std::size_t hits = 0;
+        char const* it = buffer.data();
+        char const* const end = buffer.data() + buffer.size();
+        while(it != end)
+        {
+            it = kernel(it, end);
+            if(it != end)
+            {
+                ++hits;
+                ++it;
+            }
+        }
+        return hits;
+    }
+
+    template<typename Kernel>
+    auto measure(char const* kernel_name, char const* level_name, std::string const& buffer, Kernel kernel) -> void {
+        constexpr int repetitions = 200;
+        std::size_t hits = 0;
+
+        auto const start = std::chrono::steady_clock::now();
+        for(int i = 0; i < repetitions; ++i)
+        {
+            hits += scan(buffer, kernel);
+        }
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+
+        double const gigabytes = static_cast<double>(buffer.size()) * repetitions / 1e9;
+        std::printf("%-16s %-7s %8.2f GB/s  (%zu hits)\n", kernel_name, level_name, gigabytes / elapsed.count(), hits / repetitions);
+    }
+}
+
+int main()
+{
+    constexpr std::size_t size = 1 << 20;
+    std::mt19937 random(1);
+
+    std::string strings(size, 'a');
+    for(auto& c : strings)
+    {
+        c = static_cast<char>('a' + random() % 26);
+        if(random() % 512 == 0)
+        {
+            c = random() % 2 ? '"' : '\\';
+        }
+    }
+
+    std::string whitespace(size, ' ');
+    for(auto& c : whitespace)
+    {
+        if(random() % 64 == 0)
+        {
+            c = '{';
+        }
+        else if(random() % 16 == 0)
+        {
+            c = '\n';
+        }
+    }
+
+    char const* const names[] = {"scalar", "sse2", "avx2"};
+    for(auto level = static_cast<int>(isa::scalar); level <= static_cast<int>(detect_isa()); ++level)
+    {
+        auto const set = kernels_for(static_cast<isa>(level));
+        measure("find_escape", names[level], strings, set.find_escape);
+    }
+    for(auto level = static_cast<int>(isa::scalar); level <= static_cast<int>(detect_isa()); ++level)
+    {
+        auto const set = kernels_for(static_cast<isa>(level));
+        measure("skip_whitespace", names[level], whitespace, set.skip_whitespace);
+    }
+
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <serialization/parallel.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Throughput of read_json_parallel on an NDJSON and an array input of about 100 MB,
+ * for thread counts doubling up to the hardware concurrency.
+ */
+
+struct order_line
+{
+    std::int64_t _id;
+    std::string _sku;
+    std::string _label;
+    double _price;
+    int _quantity;
+    std::vector<std::string> _tags;
+};
+
+template<typename T>
+struct registry {};
+
+template<>
+struct registry<order_line>
+{
+    static constexpr auto reflector = refl::refl<order_line>("order_line")
+            .add("id", &order_line::_id)
+            .add("sku", &order_line::_sku)
+            .add("label", &order_line::_label)
+            .add("price", &order_line::_price)
+            .add("quantity", &order_line::_quantity)
+            .add("tags", &order_line::_tags);
+};
+
+namespace
+{
+    auto make_input(dori::json::stream_format const format) -> std::string {
+        constexpr std::size_t target_size = 100u << 20;
+
+        std::string input = format == dori::json::stream_format::array ? "[" : "";
+        order_line line{._id = 0, ._sku = "SKU-000000", ._label = "", ._price = 0, ._quantity = 0, ._tags = {"fresh", "bulk", "promo"}};
+        for(std::int64_t id = 0; input.size() < target_size; ++id)
+        {
+            line._id = id;
+            line._label = "order line number " + std::to_string(id) + " with a \"quoted\" label";
+            line._price = static_cast<double>(id % 10000) / 100.0;
+            line._quantity = static_cast<int>(id % 17);
+            if(format == dori::json::stream_format::array && id != 0)
+            {
+                input.push_back(',');
+            }
+            write_json<order_line, registry>(line, input);
+            if(format == dori::json::stream_format::ndjson)
+            {
+                input.push_back('\n');
+            }
+        }
+        if(format == dori::json::stream_format::array)
+        {
+            input.push_back(']');
+        }
+        return input;
+    }
+
+    auto measure(char const* const format_name, std::string const& input, dori::json::stream_format const format) -> void {
+        std::vector<unsigned> thread_counts;
+        auto const hardware = std::max(std::thread::hardware_concurrency(), 1u);
+        for(unsigned threads = 1; threads < hardware; threads *= 2)
+        {
+            thread_counts.push_back(threads);
+        }
+        thread_counts.push_back(hardware);
+
+        double baseline = 0;
+        for(auto const threads : thread_counts)
+        {
+            dori::json::thread_pool pool(threads);
+
+            auto const start = std::chrono::steady_clock::now();
+            auto const records = read_json_parallel<order_line, registry>(input, pool, format);
+            std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+
+            double const throughput = static_cast<double>(input.size()) / elapsed.count() / 1e6;
+            if(threads == 1)
+            {
+                baseline = throughput;
+            }
+            std::printf("%-7s %2u threads: %8.1f MB/s  x%.2f  (%zu records)\n", format_name, threads, throughput, throughput / baseline, records.size());
+        }
+    }
+}
+
+int main()
+{
+    measure("ndjson", make_input(dori::json::stream_format::ndjson), dori::json::stream_format::ndjson);
+    measure("array", make_input(dori::json::stream_format::array), dori::json::stream_format::array);
+    return 0;
+}
@@ -0,0 +1,730 @@
+#include <serialization/json_serializer.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Benchmark suite over synthetic corpora: deep nesting shaped like the test foo, wide flat structs,
+ * numeric-heavy arrays, string-heavy payloads and large maps.
+ *
+ * For each corpus and each of to_json, write_json, from_json, read_json and read_json_into, reports the
+ * throughput (MB/s of json text, documents/s), per-document latency percentiles and heap allocations per
+ * document counted by a global operator new hook.
+ *
+ *   bench [--scale N] [--rounds N] [--corpus NAME] [--label TEXT] [--output FILE] [--compare FILE]
+ *
+ * --output writes the results as json, --compare reads such a file from a previous run (e.g. another
+ * commit) and prints the relative throughput and allocation changes.
+ */
+
+namespace
+{
+    std::atomic<std::size_t> allocations{0};
+
+    auto allocate(std::size_t const size, std::size_t const alignment) -> void* {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        if(alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        {
+            return std::malloc(size == 0 ? 1 : size);
+        }
+        return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    }
+
+    auto allocate_or_throw(std::size_t const size, std::size_t const alignment) -> void* {
+        if(void* const p = allocate(size, alignment))
+        {
+            return p;
+        }
+        throw std::bad_alloc();
+    }
+}
+
+// every form of operator new and delete is replaced so each allocation is counted and freed by its matching form
+auto operator new(std::size_t const size) -> void* {
+    return allocate_or_throw(size, 0);
+}
+
+auto operator new[](std::size_t const size) -> void* {
+    return allocate_or_throw(size, 0);
+}
+
+auto operator new(std::size_t const size, std::align_val_t const alignment) -> void* {
+    return allocate_or_throw(size, static_cast<std::size_t>(alignment));
+}
+
+auto operator new[](std::size_t const size, std::align_val_t const alignment) -> void* {
+    return allocate_or_throw(size, static_cast<std::size_t>(alignment));
+}
+
+auto operator new(std::size_t const size, std::nothrow_t const&) noexcept -> void* {
+    return allocate(size, 0);
+}
+
+auto operator new[](std::size_t const size, std::nothrow_t const&) noexcept -> void* {
+    return allocate(size, 0);
+}
+
+auto operator new(std::size_t const size, std::align_val_t const alignment, std::nothrow_t const&) noexcept -> void* {
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+auto operator new[](std::size_t const size, std::align_val_t const alignment, std::nothrow_t const&) noexcept -> void* {
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+auto operator delete(void* const p) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete[](void* const p) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete(void* const p, std::size_t) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete[](void* const p, std::size_t) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete(void* const p, std::align_val_t) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete[](void* const p, std::align_val_t) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete(void* const p, std::size_t, std::align_val_t) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete[](void* const p, std::size_t, std::align_val_t) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete(void* const p, std::nothrow_t const&) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete[](void* const p, std::nothrow_t const&) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete(void* const p, std::align_val_t, std::nothrow_t const&) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete[](void* const p, std::align_val_t, std::nothrow_t const&) noexcept -> void {
+    std::free(p);
+}
+
+struct leaf
+{
+    std::string _token;
+    int _weight;
+};
+
+struct branch
+{
+    std::map<std::string, std::optional<std::vector<leaf>>> _f;
+};
+
+struct tree
+{
+    std::string _name;
+    std::vector<branch> _children;
+    std::optional<branch> _spare;
+};
+
+struct wide
+{
+    std::int64_t _id;
+    std::int32_t _count;
+    std::uint32_t _flags;
+    std::int16_t _shelf;
+    std::uint8_t _grade;
+    double _price;
+    double _discount;
+    double _tax;
+    float _ratio;
+    bool _active;
+    bool _archived;
+    std::string _name;
+    std::string _sku;
+    std::string _category;
+    std::string _brand;
+    std::string _color;
+    std::int64_t _created;
+    std::int64_t _updated;
+    double _weight;
+    double _height;
+    double _width;
+    double _depth;
+    std::optional<std::string> _note;
+    std::optional<int> _rank;
+};
+
+struct series
+{
+    std::int64_t _id;
+    std::vector<double> _values;
+    std::vector<std::int64_t> _counts;
+    std::vector<float> _ratios;
+};
+
+struct document
+{
+    std::string _title;
+    std::string _body;
+    std::vector<std::string> _tags;
+    std::vector<std::string> _lines;
+};
+
+struct inventory
+{
+    std::map<std::string, leaf> _entries;
+    std::unordered_map<std::string, std::int64_t> _counts;
+};
+
+struct result
+{
+    std::string _corpus;
+    std::string _operation;
+    std::size_t _documents;
+    std::size_t _bytes;
+    double _mb_per_s;
+    double _documents_per_s;
+    double _mean_ns;
+    double _p50_ns;
+    double _p90_ns;
+    double _p99_ns;
+    double _p999_ns;
+    double _allocations_per_op;
+};
+
+struct report
+{
+    std::string _label;
+    std::size_t _scale;
+    std::size_t _rounds;
+    std::vector<result> _results;
+};
+
+template<typename T>
+struct registry {};
+
+template<>
+struct registry<leaf>
+{
+    static constexpr auto reflector = refl::refl<leaf>("leaf")
+            .add("token", &leaf::_token)
+            .add("weight", &leaf::_weight);
+};
+
+template<>
+struct registry<branch>
+{
+    static constexpr auto reflector = refl::refl<branch>("branch")
+            .add("f", &branch::_f);
+};
+
+template<>
+struct registry<tree>
+{
+    static constexpr auto reflector = refl::refl<tree>("tree")
+            .add("name", &tree::_name)
+            .add("children", &tree::_children)
+            .add("spare", &tree::_spare);
+};
+
+template<>
+struct registry<wide>
+{
+    static constexpr auto reflector = refl::refl<wide>("wide")
+            .add("id", &wide::_id)
+            .add("count", &wide::_count)
+            .add("flags", &wide::_flags)
+            .add("shelf", &wide::_shelf)
+            .add("grade", &wide::_grade)
+            .add("price", &wide::_price)
+            .add("discount", &wide::_discount)
+            .add("tax", &wide::_tax)
+            .add("ratio", &wide::_ratio)
+            .add("active", &wide::_active)
+            .add("archived", &wide::_archived)
+            .add("name", &wide::_name)
+            .add("sku", &wide::_sku)
+            .add("category", &wide::_category)
+            .add("brand", &wide::_brand)
+            .add("color", &wide::_color)
+            .add("created", &wide::_created)
+            .add("updated", &wide::_updated)
+            .add("weight", &wide::_weight)
+            .add("height", &wide::_height)
+            .add("width", &wide::_width)
+            .add("depth", &wide::_depth)
+            .add("note", &wide::_note)
+            .add("rank", &wide::_rank);
+};
+
+template<>
+struct registry<series>
+{
+    static constexpr auto reflector = refl::refl<series>("series")
+            .add("id", &series::_id)
+            .add("values", &series::_values)
+            .add("counts", &series::_counts)
+            .add("ratios", &series::_ratios);
+};
+
+template<>
+struct registry<document>
+{
+    static constexpr auto reflector = refl::refl<document>("document")
+            .add("title", &document::_title)
+            .add("body", &document::_body)
+            .add("tags", &document::_tags)
+            .add("lines", &document::_lines);
+};
+
+template<>
+struct registry<inventory>
+{
+    static constexpr auto reflector = refl::refl<inventory>("inventory")
+            .add("entries", &inventory::_entries)
+            .add("counts", &inventory::_counts);
+};
+
+template<>
+struct registry<result>
+{
+    static constexpr auto reflector = refl::refl<result>("result")
+            .add("corpus", &result::_corpus)
+            .add("operation", &result::_operation)
+            .add("documents", &result::_documents)
+            .add("bytes", &result::_bytes)
+            .add("mb_per_s", &result::_mb_per_s)
+            .add("documents_per_s", &result::_documents_per_s)
+            .add("mean_ns", &result::_mean_ns)
+            .add("p50_ns", &result::_p50_ns)
+            .add("p90_ns", &result::_p90_ns)
+            .add("p99_ns", &result::_p99_ns)
+            .add("p999_ns", &result::_p999_ns)
+            .add("allocations_per_op", &result::_allocations_per_op);
+};
+
+template<>
+struct registry<report>
+{
+    static constexpr auto reflector = refl::refl<report>("report")
+            .add("label", &report::_label)
+            .add("scale", &report::_scale)
+            .add("rounds", &report::_rounds)
+            .add("results", &report::_results);
+};
+
+namespace
+{
+    struct options
+    {
+        std::size_t _scale = 1;
+        std::size_t _rounds = 3;
+        std::string _corpus;
+        std::string _label;
+        std::string _output;
+        std::string _compare;
+    };
+
+    class generator
+    {
+    public:
+        auto number(std::size_t const bound) -> std::size_t {
+            return static_cast<std::size_t>(_random() % bound);
+        }
+
+        auto real() -> double {
+            return std::uniform_real_distribution<double>(-1e6, 1e6)(_random);
+        }
+
+        auto word(std::size_t const length) -> std::string {
+            std::string word(length, 'a');
+            for(auto& c : word)
+            {
+                c = static_cast<char>('a' + number(26));
+            }
+            return word;
+        }
+
+        // Text with the occasional character that json has to escape, or that is not ASCII
+        auto text(std::size_t const length) -> std::string {
+            std::string text;
+            text.reserve(length + 8);
+            while(text.size() < length)
+            {
+                text += word(1 + number(9));
+                switch(number(40))
+                {
+                    case 0: text += "\\\"quoted\\\""; break;
+                    case 1: text += '\n'; break;
+                    case 2: text += "\xc3\xa9t\xc3\xa9"; break;
+                    default: text += ' '; break;
+                }
+            }
+            return text;
+        }
+
+    private:
+        std::mt19937_64 _random{42};
+    };
+
+    auto make_leaves(generator& gen, std::size_t const count) -> std::vector<leaf> {
+        std::vector<leaf> leaves(count);
+        for(auto& l : leaves)
+        {
+            l = leaf{._token = gen.word(8 + gen.number(24)), ._weight = static_cast<int>(gen.number(1000))};
+        }
+        return leaves;
+    }
+
+    auto make_branch(generator& gen) -> branch {
+        branch b;
+        for(std::size_t i = 0, keys = 2 + gen.number(4); i < keys; ++i)
+        {
+            if(gen.number(5) == 0)
+            {
+                b._f[gen.word(6)] = std::nullopt;
+            }
+            else
+            {
+                b._f[gen.word(6)] = make_leaves(gen, 1 + gen.number(4));
+            }
+        }
+        return b;
+    }
+
+    auto make_trees(generator& gen, std::size_t const count) -> std::vector<tree> {
+        std::vector<tree> trees(count);
+        for(auto& t : trees)
+        {
+            t._name = gen.word(12);
+            t._children.resize(2 + gen.number(6));
+            for(auto& child : t._children)
+            {
+                child = make_branch(gen);
+            }
+            if(gen.number(2) == 0)
+            {
+                t._spare = make_branch(gen);
+            }
+        }
+        return trees;
+    }
+
+    auto make_wides(generator& gen, std::size_t const count) -> std::vector<wide> {
+        std::vector<wide> wides(count);
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            wides[i] = wide{._id = static_cast<std::int64_t>(i) * 7919,
+                            ._count = static_cast<std::int32_t>(gen.number(100000)),
+                            ._flags = static_cast<std::uint32_t>(gen.number(1u << 31)),
+                            ._shelf = static_cast<std::int16_t>(gen.number(30000)),
+                            ._grade = static_cast<std::uint8_t>(gen.number(256)),
+                            ._price = static_cast<double>(gen.number(1000000)) / 100.0,
+                            ._discount = static_cast<double>(gen.number(100)) / 100.0,
+                            ._tax = 0.2,
+                            ._ratio = static_cast<float>(gen.number(1000)) / 7.0f,
+                            ._active = gen.number(2) == 0,
+                            ._archived = gen.number(10) == 0,
+                            ._name = gen.text(24),
+                            ._sku = "SKU-" + std::to_string(i),
+                            ._category = gen.word(10),
+                            ._brand = gen.word(8),
+                            ._color = gen.word(5),
+                            ._created = 1700000000000 + static_cast<std::int64_t>(i),
+                            ._updated = 1700000000000 + static_cast<std::int64_t>(gen.number(1000000)),
+                            ._weight = gen.real(),
+                            ._height = gen.real(),
+                            ._width = gen.real(),
+                            ._depth = gen.real(),
+                            ._note = gen.number(3) == 0 ? std::optional<std::string>(gen.text(40)) : std::nullopt,
+                            ._rank = gen.number(2) == 0 ? std::optional<int>(static_cast<int>(gen.number(100))) : std::nullopt};
+        }
+        return wides;
+    }
+
+    auto make_series(generator& gen, std::size_t const count) -> std::vector<series> {
+        std::vector<series> all(count);
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            auto& s = all[i];
+            s._id = static_cast<std::int64_t>(i);
+            s._values.resize(256);
+            std::ranges::generate(s._values, [&] { return gen.real(); });
+            s._counts.resize(256);
+            std::ranges::generate(s._counts, [&] { return static_cast<std::int64_t>(gen.number(1ull << 40)) - (1ll << 39); });
+            s._ratios.resize(128);
+            std::ranges::generate(s._ratios, [&] { return static_cast<float>(gen.real() / 1e3); });
+        }
+        return all;
+    }
+
+    auto make_documents(generator& gen, std::size_t const count) -> std::vector<document> {
+        std::vector<document> documents(count);
+        for(auto& d : documents)
+        {
+            d._title = gen.text(60);
+            d._body = gen.text(2000);
+            d._tags.resize(8);
+            std::ranges::generate(d._tags, [&] { return gen.word(4 + gen.number(12)); });
+            d._lines.resize(16);
+            std::ranges::generate(d._lines, [&] { return gen.text(80); });
+        }
+        return documents;
+    }
+
+    auto make_inventories(generator& gen, std::size_t const count) -> std::vector<inventory> {
+        std::vector<inventory> inventories(count);
+        for(auto& i : inventories)
+        {
+            for(std::size_t k = 0; k < 1000; ++k)
+            {
+                auto key = gen.word(12);
+                i._counts.emplace(key, static_cast<std::int64_t>(gen.number(1000000)));
+                i._entries.emplace(std::move(key), leaf{._token = gen.word(16), ._weight = static_cast<int>(k)});
+            }
+        }
+        return inventories;
+    }
+
+    auto percentile(std::vector<double> const& sorted, double const p) -> double {
+        return sorted[static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1))];
+    }
+
+    /**
+     * Time op(i) for every document, over options._rounds rounds after one warm-up round
+     */
+    template<typename Op>
+    auto measure(options const& opts, char const* const corpus, char const* const operation,
+                 std::size_t const documents, std::size_t const bytes, Op&& op) -> result {
+        for(std::size_t i = 0; i < documents; ++i)
+        {
+            op(i);
+        }
+
+        std::vector<double> latencies;
+        latencies.reserve(documents * opts._rounds);
+        auto const allocations_before = allocations.load(std::memory_order_relaxed);
+        for(std::size_t round = 0; round < opts._rounds; ++round)
+        {
+            for(std::size_t i = 0; i < documents; ++i)
+            {
+                auto const start = std::chrono::steady_clock::now();
+                op(i);
+                std::chrono::duration<double, std::nano> const elapsed = std::chrono::steady_clock::now() - start;
+                latencies.push_back(elapsed.count());
+            }
+        }
+        // the latencies were reserved up front, nothing else allocates during the rounds
+        auto const allocated = allocations.load(std::memory_order_relaxed) - allocations_before;
+
+        double total = 0;
+        for(auto const latency : latencies)
+        {
+            total += latency;
+        }
+        std::ranges::sort(latencies);
+
+        double const ops = static_cast<double>(latencies.size());
+        double const seconds = total / 1e9;
+        return result{._corpus = corpus,
+                      ._operation = operation,
+                      ._documents = documents,
+                      ._bytes = bytes,
+                      ._mb_per_s = static_cast<double>(bytes) * static_cast<double>(opts._rounds) / seconds / 1e6,
+                      ._documents_per_s = ops / seconds,
+                      ._mean_ns = total / ops,
+                      ._p50_ns = percentile(latencies, 0.5),
+                      ._p90_ns = percentile(latencies, 0.9),
+                      ._p99_ns = percentile(latencies, 0.99),
+                      ._p999_ns = percentile(latencies, 0.999),
+                      ._allocations_per_op = static_cast<double>(allocated) / ops};
+    }
+
+    auto print(result const& r) -> void {
+        std::printf("%-8s %-15s %9.1f MB/s %11.0f doc/s  p50 %9.0f ns  p99 %9.0f ns  p99.9 %9.0f ns  %8.1f alloc/op\n",
+                    r._corpus.c_str(), r._operation.c_str(), r._mb_per_s, r._documents_per_s,
+                    r._p50_ns, r._p99_ns, r._p999_ns, r._allocations_per_op);
+    }
+
+    template<typename T>
+    auto run(options const& opts, char const* const corpus, std::vector<T> const& documents, std::vector<result>& results) -> void {
+        if(!opts._corpus.empty() && opts._corpus != corpus)
+        {
+            return;
+        }
+
+        std::vector<std::string> texts;
+        texts.reserve(documents.size());
+        std::size_t bytes = 0;
+        for(auto const& d : documents)
+        {
+            texts.push_back(to_json<T, registry>(d));
+            bytes += texts.back().size();
+        }
+
+        std::size_t sink = 0;
+        std::string buffer;
+        T decoded{};
+        T recycled{};
+        auto const add = [&](result const& r) {
+            print(r);
+            results.push_back(r);
+        };
+
+        add(measure(opts, corpus, "to_json", documents.size(), bytes, [&](std::size_t const i) {
+            sink += to_json<T, registry>(documents[i]).size();
+        }));
+        add(measure(opts, corpus, "write_json", documents.size(), bytes, [&](std::size_t const i) {
+            buffer.clear();
+            write_json<T, registry>(documents[i], buffer);
+            sink += buffer.size();
+        }));
+        add(measure(opts, corpus, "from_json", documents.size(), bytes, [&](std::size_t const i) {
+            decoded = from_json<T, registry>(texts[i]);
+        }));
+        add(measure(opts, corpus, "read_json", documents.size(), bytes, [&](std::size_t const i) {
+            decoded = read_json<T, registry>(texts[i]);
+        }));
+        add(measure(opts, corpus, "read_json_into", documents.size(), bytes, [&](std::size_t const i) {
+            read_json_into<T, registry>(texts[i], recycled);
+        }));
+
+        // keep the encoded sizes and decoded documents observable
+        sink += to_json<T, registry>(decoded).size() + to_json<T, registry>(recycled).size();
+        if(sink == 0)
+        {
+            std::printf("empty corpus %s\n", corpus);
+        }
+    }
+
+    auto compare(std::string const& path, std::vector<result> const& results) -> bool {
+        std::ifstream file(path, std::ios::binary);
+        if(!file)
+        {
+            std::fprintf(stderr, "cannot open %s\n", path.c_str());
+            return false;
+        }
+        std::string const text{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+        auto const baseline = read_json<report, registry>(text);
+
+        std::printf("\ncompared with %s (%s)\n", path.c_str(), baseline._label.c_str());
+        for(auto const& r : results)
+        {
+            auto const before = std::ranges::find_if(baseline._results, [&](result const& b) {
+                return b._corpus == r._corpus && b._operation == r._operation;
+            });
+            if(before == baseline._results.end())
+            {
+                continue;
+            }
+            std::printf("%-8s %-15s throughput %+7.1f%%  p99 %+7.1f%%  alloc/op %+8.1f\n",
+                        r._corpus.c_str(), r._operation.c_str(),
+                        (r._mb_per_s / before->_mb_per_s - 1) * 100,
+                        (r._p99_ns / before->_p99_ns - 1) * 100,
+                        r._allocations_per_op - before->_allocations_per_op);
+        }
+        return true;
+    }
+
+    auto parse_options(int const argc, char** const argv, options& opts) -> bool {
+        for(int i = 1; i < argc; ++i)
+        {
+            std::string_view const arg = argv[i];
+            if(i + 1 == argc)
+            {
+                return false;
+            }
+            char const* const value = argv[++i];
+            if(arg == "--scale")
+            {
+                opts._scale = std::max<std::size_t>(std::strtoull(value, nullptr, 10), 1);
+            }
+            else if(arg == "--rounds")
+            {
+                opts._rounds = std::max<std::size_t>(std::strtoull(value, nullptr, 10), 1);
+            }
+            else if(arg == "--corpus")
+            {
+                opts._corpus = value;
+            }
+            else if(arg == "--label")
+            {
+                opts._label = value;
+            }
+            else if(arg == "--output")
+            {
+                opts._output = value;
+            }
+            else if(arg == "--compare")
+            {
+                opts._compare = value;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    options opts;
+    if(!parse_options(argc, argv, opts))
+    {
+        std::fprintf(stderr, "usage: %s [--scale N] [--rounds N] [--corpus deep|wide|numeric|strings|maps] "
+                             "[--label TEXT] [--output FILE] [--compare FILE]\n", argv[0]);
+        return 2;
+    }
+
+    generator gen;
+    std::vector<result> results;
+    run(opts, "deep", make_trees(gen, 2000 * opts._scale), results);
+    run(opts, "wide", make_wides(gen, 20000 * opts._scale), results);
+    run(opts, "numeric", make_series(gen, 500 * opts._scale), results);
+    run(opts, "strings", make_documents(gen, 1000 * opts._scale), results);
+    run(opts, "maps", make_inventories(gen, 50 * opts._scale), results);
+
+    if(!opts._output.empty())
+    {
+        std::string json;
+        write_json<report, registry>(report{._label = opts._label, ._scale = opts._scale, ._rounds = opts._rounds, ._results = results}, json);
+        std::ofstream file(opts._output, std::ios::binary);
+        file << json << '\n';
+        if(!file)
+        {
+            std::fprintf(stderr, "cannot write %s\n", opts._output.c_str());
+            return 1;
+        }
+    }
+    if(!opts._compare.empty() && !compare(opts._compare, results))
+    {
+        return 1;
+    }
+    return 0;
+}
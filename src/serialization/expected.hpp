@@ -0,0 +1,141 @@
+#pragma once
+#include <version>
+
+#if defined(__cpp_lib_expected)
+#include <expected>
+#else
+#include <type_traits>
+#include <utility>
+#include <variant>
+#endif
+
+/**
+ * std::expected where the standard library provides it, a minimal equivalent otherwise (C++20 libraries)
+ */
+namespace dori
+{
+#if defined(__cpp_lib_expected)
+    using std::expected;
+    using std::unexpected;
+#else
+    template<typename E>
+    class unexpected
+    {
+    public:
+        explicit unexpected(E error) :
+            _error(std::move(error))
+        {}
+
+        auto error() & -> E& {
+            return _error;
+        }
+
+        auto error() const& -> E const& {
+            return _error;
+        }
+
+        auto error() && -> E&& {
+            return std::move(_error);
+        }
+
+    private:
+        E _error;
+    };
+
+    template<typename E>
+    unexpected(E) -> unexpected<E>;
+
+    /**
+     * @brief Either a T or an error E, the subset of std::expected used by the library
+     */
+    template<typename T, typename E>
+    class expected
+    {
+    public:
+        using value_type = T;
+        using error_type = E;
+
+        expected() requires(std::is_default_constructible_v<T>) :
+            _storage(std::in_place_index<0>)
+        {}
+
+        expected(T value) :
+            _storage(std::in_place_index<0>, std::move(value))
+        {}
+
+        template<typename G>
+        expected(unexpected<G> error) :
+            _storage(std::in_place_index<1>, std::move(error).error())
+        {}
+
+        auto has_value() const -> bool {
+            return _storage.index() == 0;
+        }
+
+        explicit operator bool() const {
+            return has_value();
+        }
+
+        /**
+         * @throws std::bad_variant_access if this holds an error
+         */
+        auto value() & -> T& {
+            return std::get<0>(_storage);
+        }
+
+        auto value() const& -> T const& {
+            return std::get<0>(_storage);
+        }
+
+        auto value() && -> T&& {
+            return std::get<0>(std::move(_storage));
+        }
+
+        template<typename U>
+        auto value_or(U&& fallback) const& -> T {
+            return has_value() ? **this : static_cast<T>(std::forward<U>(fallback));
+        }
+
+        /**
+         * @brief The value, has_value() must be true
+         */
+        auto operator*() & -> T& {
+            return *std::get_if<0>(&_storage);
+        }
+
+        auto operator*() const& -> T const& {
+            return *std::get_if<0>(&_storage);
+        }
+
+        auto operator*() && -> T&& {
+            return std::move(*std::get_if<0>(&_storage));
+        }
+
+        auto operator->() -> T* {
+            return std::get_if<0>(&_storage);
+        }
+
+        auto operator->() const -> T const* {
+            return std::get_if<0>(&_storage);
+        }
+
+        /**
+         * @brief The error, has_value() must be false
+         */
+        auto error() & -> E& {
+            return *std::get_if<1>(&_storage);
+        }
+
+        auto error() const& -> E const& {
+            return *std::get_if<1>(&_storage);
+        }
+
+        auto error() && -> E&& {
+            return std::move(*std::get_if<1>(&_storage));
+        }
+
+    private:
+        std::variant<T, E> _storage;
+    };
+#endif
+}
@@ -0,0 +1,280 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#include <refl/refl.hpp>
+
+#include "json_writer.hpp"
+
+namespace dori::meta
+{
+    /**
+     * @brief Number of fields registered in Registry<T>::reflector
+     */
+    template<typename T, template<typename> typename Registry>
+    constexpr std::size_t field_count = refl::apply([](auto const& ... fields) {
+        return sizeof...(fields);
+    }, Registry<T>::reflector);
+
+    /**
+     * @brief Field names of Registry<T>::reflector, in declaration order
+     */
+    template<typename T, template<typename> typename Registry>
+    constexpr auto field_names = refl::apply([](auto const& ... fields) {
+        return std::array<std::string_view, sizeof...(fields)>{std::string_view(fields.name())...};
+    }, Registry<T>::reflector);
+
+    /**
+     * @brief I-th field descriptor of Registry<T>::reflector, as a constant (its ptr() can be used in constant expressions)
+     */
+    template<typename T, template<typename> typename Registry, std::size_t I>
+    constexpr auto field_at = refl::apply([](auto const& ... fields) {
+        return std::get<I>(std::tuple(fields...));
+    }, Registry<T>::reflector);
+
+    template<std::size_t N>
+    struct field_order
+    {
+        std::array<std::size_t, N> index{};
+        std::size_t size = 0;
+    };
+
+    /**
+     * @brief Declaration indices of the fields in the order nlohmann::json emits them
+     *
+     * nlohmann::json stores objects in a std::map, so keys come out byte-wise sorted and,
+     * on duplicated names, the first registered field wins.
+     */
+    template<typename T, template<typename> typename Registry>
+    constexpr auto sorted_fields = [] {
+        constexpr auto const& names = field_names<T, Registry>;
+
+        // insertion sort: stable and usable in constant expressions
+        std::array<std::size_t, names.size()> sorted{};
+        for(std::size_t i = 0; i < sorted.size(); ++i)
+        {
+            std::size_t j = i;
+            for(; j > 0 && names[i] < names[sorted[j - 1]]; --j)
+            {
+                sorted[j] = sorted[j - 1];
+            }
+            sorted[j] = i;
+        }
+
+        field_order<names.size()> order;
+        for(std::size_t i = 0; i < sorted.size(); ++i)
+        {
+            if(i == 0 || names[sorted[i]] != names[sorted[i - 1]])
+            {
+                order.index[order.size++] = sorted[i];
+            }
+        }
+        return order;
+    }();
+
+    /**
+     * @brief Declaration index of the field emitted after each field in sorted_fields order, field_count after the last
+     *
+     * Decoders pass it as the expected next key to field_index::find, so on the writer's own output every
+     * lookup after the first hits without hashing, whatever the declaration order.
+     */
+    template<typename T, template<typename> typename Registry>
+    constexpr auto next_field = [] {
+        constexpr auto const& order = sorted_fields<T, Registry>;
+        constexpr std::size_t count = field_count<T, Registry>;
+
+        std::array<std::size_t, count> next{};
+        next.fill(count);
+        for(std::size_t i = 0; i < order.size; ++i)
+        {
+            next[order.index[i]] = i + 1 < order.size ? order.index[i + 1] : count;
+        }
+        return next;
+    }();
+
+    /**
+     * @brief Declaration index of the field emitted first, field_count if there is none
+     */
+    template<typename T, template<typename> typename Registry>
+    constexpr std::size_t first_field = sorted_fields<T, Registry>.size != 0 ? sorted_fields<T, Registry>.index[0] : field_count<T, Registry>;
+
+    /**
+     * @brief Hash of a field name, usable both at compile time and on incoming keys
+     */
+    constexpr auto hash_key(std::string_view const key) -> std::uint64_t {
+        std::uint64_t hash = 0xCBF29CE484222325ull ^ key.size();
+        for(char const c : key)
+        {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+    /**
+     * @brief Compile-time perfect hash from the field names of Registry<T>::reflector to their declaration index
+     *
+     * The slot of a key is the top bits of hash_key(key) * multiplier. A multiplier that puts every name
+     * in its own slot is searched at compile time; if none is found within the search budget the table
+     * falls back to linear probing, so lookups stay correct whatever the number of fields.
+     */
+    template<typename T, template<typename> typename Registry>
+    class field_index
+    {
+    public:
+        static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+        /**
+         * @brief Declaration index of the field named key, npos if there is none
+         */
+        static constexpr auto find(std::string_view const key) -> std::size_t {
+            if constexpr(names.size() == 0)
+            {
+                return npos;
+            }
+            else
+            {
+                auto slot = slot_of(hash_key(key), table.multiplier);
+                while(table.slots[slot] != 0)
+                {
+                    std::size_t const index = table.slots[slot] - 1u;
+                    if(names[index] == key)
+                    {
+                        return index;
+                    }
+                    slot = (slot + 1) & (slot_count - 1);
+                }
+                return npos;
+            }
+        }
+
+        /**
+         * @brief Same as find, but first tries the field at expected so inputs in a known order skip the hash, see next_field
+         */
+        static constexpr auto find(std::string_view const key, std::size_t const expected) -> std::size_t {
+            if(expected < names.size() && names[expected] == key)
+            {
+                return expected;
+            }
+            return find(key);
+        }
+
+    private:
+        static constexpr auto const& names = field_names<T, Registry>;
+
+        static constexpr std::size_t slot_bits = [] {
+            std::size_t bits = 3;
+            while((std::size_t{1} << bits) < names.size() * 8)
+            {
+                ++bits;
+            }
+            return bits;
+        }();
+        static constexpr std::size_t slot_count = std::size_t{1} << slot_bits;
+
+        using slot_type = std::conditional_t<(names.size() < std::numeric_limits<std::uint8_t>::max()), std::uint8_t, std::uint16_t>;
+
+        struct hash_table
+        {
+            std::uint64_t multiplier = 0;
+            std::array<slot_type, slot_count> slots{};
+        };
+
+        static constexpr auto slot_of(std::uint64_t const hash, std::uint64_t const multiplier) -> std::size_t {
+            return static_cast<std::size_t>((hash * multiplier) >> (64 - slot_bits));
+        }
+
+        static constexpr auto fill(std::uint64_t const multiplier, bool const allow_collisions) -> hash_table {
+            hash_table result{multiplier, {}};
+            for(std::size_t i = 0; i < names.size(); ++i)
+            {
+                auto slot = slot_of(hash_key(names[i]), multiplier);
+                while(result.slots[slot] != 0)
+                {
+                    if(!allow_collisions)
+                    {
+                        return hash_table{};
+                    }
+                    slot = (slot + 1) & (slot_count - 1);
+                }
+                result.slots[slot] = static_cast<slot_type>(i + 1);
+            }
+            return result;
+        }
+
+        static constexpr hash_table table = [] {
+            std::uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+            for(int attempt = 0; attempt < 4096; ++attempt)
+            {
+                auto const candidate = fill(multiplier, false);
+                if(candidate.multiplier != 0)
+                {
+                    return candidate;
+                }
+                multiplier = multiplier * 6364136223846793005ull + 1442695040888963407ull;
+                multiplier |= 1;
+            }
+            return fill(0x9E3779B97F4A7C15ull, true);
+        }();
+    };
+}
+
+namespace dori::json
+{
+    /**
+     * @brief Ready-to-emit key fragments of Registry<T>::reflector, in the order the writer emits fields
+     *
+     * Fragment i is the quoted, escaped key followed by ':', with the separator folded in front:
+     * '{' for the first field and ',' for the others, e.g. {"data": then ,"success":
+     * Writing an object is then a copy of constant fragments interleaved with the values, and a closing '}'.
+     */
+    template<typename T, template<typename> typename Registry>
+    class key_fragments
+    {
+    public:
+        static constexpr std::size_t size = dori::meta::sorted_fields<T, Registry>.size;
+
+        static constexpr auto get(std::size_t const i) -> std::string_view {
+            return std::string_view(table.chars.data() + table.offsets[i], table.offsets[i + 1] - table.offsets[i]);
+        }
+
+    private:
+        static constexpr auto const& names = dori::meta::field_names<T, Registry>;
+        static constexpr auto const& order = dori::meta::sorted_fields<T, Registry>;
+
+        static constexpr std::size_t total_size = [] {
+            std::size_t total = 0;
+            for(std::size_t i = 0; i < order.size; ++i)
+            {
+                total += 4 + escaped_size(names[order.index[i]]);
+            }
+            return total;
+        }();
+
+        struct fragment_table
+        {
+            std::array<char, total_size> chars{};
+            std::array<std::size_t, size + 1> offsets{};
+        };
+
+        static constexpr fragment_table table = [] {
+            fragment_table result;
+            char* out = result.chars.data();
+            for(std::size_t i = 0; i < order.size; ++i)
+            {
+                result.offsets[i] = static_cast<std::size_t>(out - result.chars.data());
+                *out++ = i == 0 ? '{' : ',';
+                *out++ = '"';
+                out = escape_into(out, names[order.index[i]]);
+                *out++ = '"';
+                *out++ = ':';
+            }
+            result.offsets[order.size] = static_cast<std::size_t>(out - result.chars.data());
+            return result;
+        }();
+    };
+}
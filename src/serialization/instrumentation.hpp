@@ -0,0 +1,283 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json_writer.hpp"
+
+/**
+ * Opt-in instrumentation of the json serializer, selected per registered type at compile time.
+ *
+ * A registry specialization declaring
+ *
+ *     using instrumentation = dori::json::counters;
+ *
+ * next to its reflector gets its encodes and decodes recorded under the reflector name. Registries that
+ * declare nothing use no_instrumentation, whose serializer is the uninstrumented one: no clock read, no
+ * counter, no branch.
+ */
+namespace dori::json
+{
+    enum class operation
+    {
+        encode,
+        decode
+    };
+
+    /**
+     * @brief The policy of types whose registry declares no instrumentation
+     */
+    struct no_instrumentation
+    {
+        static constexpr bool enabled = false;
+    };
+
+    /**
+     * @brief Totals of one direction of one type
+     */
+    struct operation_stats
+    {
+        std::uint64_t calls = 0;
+        std::uint64_t failures = 0;
+        std::uint64_t bytes = 0;
+        std::uint64_t nanoseconds = 0;
+        std::uint64_t allocations = 0;
+    };
+
+    struct type_stats
+    {
+        std::string_view name;
+        operation_stats encode;
+        operation_stats decode;
+    };
+
+    /**
+     * @brief Function returning a running count of heap allocations, e.g. read from a global operator new hook
+     */
+    using allocation_counter = auto (*)() noexcept -> std::uint64_t;
+
+    inline std::atomic<allocation_counter> allocation_source{nullptr};
+
+    /**
+     * @brief Install the allocation count source of the counters policy, nullptr to stop counting allocations
+     */
+    inline auto set_allocation_counter(allocation_counter const counter) -> void {
+        allocation_source.store(counter, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Policy counting calls, failures, bytes, time and allocations per type, safe to use from several threads
+     *
+     * Each reflected object is recorded, nested ones included, so the figures of a type contain those of
+     * the members it nests. The DOM paths (to_json, from_json) only record the top-level type, serialized_size records nothing.
+     */
+    class counters
+    {
+        struct atomic_stats
+        {
+            std::atomic<std::uint64_t> calls{0};
+            std::atomic<std::uint64_t> failures{0};
+            std::atomic<std::uint64_t> bytes{0};
+            std::atomic<std::uint64_t> nanoseconds{0};
+            std::atomic<std::uint64_t> allocations{0};
+
+            auto load() const -> operation_stats {
+                return operation_stats{.calls = calls.load(std::memory_order_relaxed),
+                                       .failures = failures.load(std::memory_order_relaxed),
+                                       .bytes = bytes.load(std::memory_order_relaxed),
+                                       .nanoseconds = nanoseconds.load(std::memory_order_relaxed),
+                                       .allocations = allocations.load(std::memory_order_relaxed)};
+            }
+
+            auto reset() -> void {
+                calls.store(0, std::memory_order_relaxed);
+                failures.store(0, std::memory_order_relaxed);
+                bytes.store(0, std::memory_order_relaxed);
+                nanoseconds.store(0, std::memory_order_relaxed);
+                allocations.store(0, std::memory_order_relaxed);
+            }
+        };
+
+        struct slot
+        {
+            std::string_view name;
+            atomic_stats encode;
+            atomic_stats decode;
+        };
+
+        struct slots
+        {
+            std::mutex mutex;
+            std::deque<slot> all;// deque: slots never move once handed out
+        };
+
+        static auto registered() -> slots& {
+            static slots instance;
+            return instance;
+        }
+
+        /**
+         * @brief The slot of T as registered by Registry, a type registered twice under two names has two slots
+         */
+        template<typename T, template<typename> typename Registry>
+        static auto slot_of(std::string_view const name) -> slot& {
+            static slot& s = [&]() -> slot& {
+                auto& r = registered();
+                std::lock_guard const lock(r.mutex);
+                return r.all.emplace_back(name);
+            }();
+            return s;
+        }
+
+        static auto allocations() -> std::uint64_t {
+            auto const counter = allocation_source.load(std::memory_order_relaxed);
+            return counter != nullptr ? counter() : 0;
+        }
+
+    public:
+        static constexpr bool enabled = true;
+
+        /**
+         * @brief Records one encode or decode of a T registered by Registry when destroyed, as a failure unless done was called
+         */
+        template<typename T, template<typename> typename Registry>
+        class probe
+        {
+        public:
+            probe(std::string_view const name, operation const op) :
+                _stats(op == operation::encode ? slot_of<T, Registry>(name).encode : slot_of<T, Registry>(name).decode),
+                _allocations(allocations()),
+                _start(std::chrono::steady_clock::now())
+            {}
+
+            probe(probe const&) = delete;
+            auto operator=(probe const&) -> probe& = delete;
+
+            ~probe() {
+                auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start);
+                _stats.calls.fetch_add(1, std::memory_order_relaxed);
+                _stats.nanoseconds.fetch_add(static_cast<std::uint64_t>(elapsed.count()), std::memory_order_relaxed);
+                _stats.allocations.fetch_add(allocations() - _allocations, std::memory_order_relaxed);
+                if(_succeeded)
+                {
+                    _stats.bytes.fetch_add(_bytes, std::memory_order_relaxed);
+                }
+                else
+                {
+                    _stats.failures.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            /**
+             * @param bytes json text written or read
+             */
+            auto done(std::size_t const bytes) -> void {
+                _succeeded = true;
+                _bytes = bytes;
+            }
+
+        private:
+            atomic_stats& _stats;
+            std::uint64_t const _allocations;
+            std::chrono::steady_clock::time_point const _start;
+            std::size_t _bytes = 0;
+            bool _succeeded = false;
+        };
+
+        /**
+         * @brief Totals of every type recorded so far, in order of first use
+         */
+        static auto snapshot() -> std::vector<type_stats> {
+            auto& r = registered();
+            std::lock_guard const lock(r.mutex);
+            std::vector<type_stats> stats;
+            stats.reserve(r.all.size());
+            for(auto const& s : r.all)
+            {
+                stats.push_back(type_stats{.name = s.name, .encode = s.encode.load(), .decode = s.decode.load()});
+            }
+            return stats;
+        }
+
+        /**
+         * @brief Zero the totals, the types stay listed
+         */
+        static auto reset() -> void {
+            auto& r = registered();
+            std::lock_guard const lock(r.mutex);
+            for(auto& s : r.all)
+            {
+                s.encode.reset();
+                s.decode.reset();
+            }
+        }
+
+        /**
+         * @brief The snapshot as a json array of {"name":..., "encode":{...}, "decode":{...}}
+         */
+        static auto export_json() -> std::string {
+            std::string json;
+            writer<std::string> w(json);
+            auto const write_stats = [&](std::string_view const key, operation_stats const& stats) {
+                w.write_string(key);
+                w.write_raw(":{\"calls\":");
+                w.write_integer(stats.calls);
+                w.write_raw(",\"failures\":");
+                w.write_integer(stats.failures);
+                w.write_raw(",\"bytes\":");
+                w.write_integer(stats.bytes);
+                w.write_raw(",\"nanoseconds\":");
+                w.write_integer(stats.nanoseconds);
+                w.write_raw(",\"allocations\":");
+                w.write_integer(stats.allocations);
+                w.put('}');
+            };
+
+            w.put('[');
+            bool first = true;
+            for(auto const& stats : snapshot())
+            {
+                if(!first)
+                {
+                    w.put(',');
+                }
+                first = false;
+                w.write_raw("{\"name\":");
+                w.write_string(stats.name);
+                w.put(',');
+                write_stats("encode", stats.encode);
+                w.put(',');
+                write_stats("decode", stats.decode);
+                w.put('}');
+            }
+            w.put(']');
+            return json;
+        }
+    };
+}
+
+namespace dori::meta
+{
+    /**
+     * @brief The instrumentation policy Registry<T> declares, dori::json::no_instrumentation if none
+     */
+    template<typename T, template<typename> typename Registry>
+    struct instrumentation_of
+    {
+        using type = dori::json::no_instrumentation;
+    };
+
+    template<typename T, template<typename> typename Registry> requires requires { typename Registry<T>::instrumentation; }
+    struct instrumentation_of<T, Registry>
+    {
+        using type = typename Registry<T>::instrumentation;
+    };
+
+    template<typename T, template<typename> typename Registry>
+    using instrumentation_t = typename instrumentation_of<T, Registry>::type;
+}
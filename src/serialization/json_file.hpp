@@ -0,0 +1,342 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#if __has_include(<sys/mman.h>) && __has_include(<fcntl.h>) && __has_include(<unistd.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define DORI_JSON_HAS_MMAP 1
+#endif
+
+#include "json_serializer.hpp"
+#include "json_stream.hpp"
+
+/**
+ * Whole-file input and output.
+ *
+ * Input is decoded straight from a read-only memory mapping of the file, without copying it into a string.
+ * Output is streamed through a page-aligned block buffer written to the file in large blocks, without
+ * building the whole text in memory.
+ */
+namespace dori::json
+{
+    constexpr std::size_t default_file_block_size = 1 << 20;
+
+    /**
+     * @brief Output buffer handing its content to Sink in blocks of block_size bytes from a page-aligned buffer
+     *
+     * Appends larger than a block go straight to the sink. flush() must be called once writing is over.
+     */
+    template<typename Sink>
+    class block_buffer
+    {
+    public:
+        static constexpr std::align_val_t alignment{4096};
+
+        explicit block_buffer(Sink& sink, std::size_t const block_size = default_file_block_size) :
+            _sink(sink),
+            _data(static_cast<char*>(::operator new(std::max<std::size_t>(block_size, 1), alignment))),
+            _capacity(std::max<std::size_t>(block_size, 1))
+        {}
+
+        block_buffer(block_buffer const&) = delete;
+        auto operator=(block_buffer const&) -> block_buffer& = delete;
+
+        ~block_buffer() {
+            ::operator delete(_data, alignment);
+        }
+
+        auto push_back(char const c) -> void {
+            if(_size == _capacity)
+            {
+                flush();
+            }
+            _data[_size++] = c;
+        }
+
+        auto append(char const* const data, std::size_t const size) -> void {
+            if(size > _capacity - _size)
+            {
+                flush();
+                if(size >= _capacity)
+                {
+                    _sink.write(std::string_view(data, size));
+                    return;
+                }
+            }
+            std::memcpy(_data + _size, data, size);
+            _size += size;
+        }
+
+        auto end() -> char* {
+            return _data + _size;
+        }
+
+        auto insert(char* const, char const* const first, char const* const last) -> void {
+            append(first, static_cast<std::size_t>(last - first));
+        }
+
+        auto flush() -> void {
+            if(_size != 0)
+            {
+                _sink.write(std::string_view(_data, _size));
+                _size = 0;
+            }
+        }
+
+    private:
+        Sink& _sink;
+        char* _data;
+        std::size_t _capacity;
+        std::size_t _size = 0;
+    };
+
+#if defined(DORI_JSON_HAS_MMAP)
+    /**
+     * @brief Owned file descriptor
+     */
+    class unique_fd
+    {
+    public:
+        explicit unique_fd(int const fd) :
+            _fd(fd)
+        {}
+
+        unique_fd(unique_fd const&) = delete;
+        auto operator=(unique_fd const&) -> unique_fd& = delete;
+
+        ~unique_fd() {
+            if(_fd >= 0)
+            {
+                ::close(_fd);
+            }
+        }
+
+        auto get() const -> int {
+            return _fd;
+        }
+
+        /**
+         * @brief Close now, reporting the errors a destructor would have to drop (e.g. delayed write errors)
+         * @throws std::system_error if close(2) fails
+         */
+        auto close() -> void {
+            if(::close(std::exchange(_fd, -1)) != 0)
+            {
+                throw std::system_error(errno, std::generic_category(), "json file: close failed");
+            }
+        }
+
+    private:
+        int _fd;
+    };
+
+    /**
+     * @brief Read-only memory mapping of a whole file, populated ahead and advised for a sequential read
+     *
+     * Values decoded with from_json_borrowed or holding lazy members view the mapping, which must outlive them,
+     * see from_json_file_borrowed.
+     */
+    class mapped_file
+    {
+    public:
+        /**
+         * @throws std::system_error if the file cannot be opened or mapped
+         */
+        explicit mapped_file(std::filesystem::path const& path) {
+            unique_fd const fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+            if(fd.get() < 0)
+            {
+                throw std::system_error(errno, std::generic_category(), "json file: cannot open " + path.string());
+            }
+
+            struct stat status{};
+            if(::fstat(fd.get(), &status) != 0)
+            {
+                throw std::system_error(errno, std::generic_category(), "json file: cannot stat " + path.string());
+            }
+            _size = static_cast<std::size_t>(status.st_size);
+            if(_size == 0)
+            {
+                return;
+            }
+
+            int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+            flags |= MAP_POPULATE;
+#endif
+            void* const data = ::mmap(nullptr, _size, PROT_READ, flags, fd.get(), 0);
+            if(data == MAP_FAILED)
+            {
+                throw std::system_error(errno, std::generic_category(), "json file: cannot map " + path.string());
+            }
+            _data = static_cast<char const*>(data);
+            ::madvise(data, _size, MADV_SEQUENTIAL);
+        }
+
+        mapped_file(mapped_file const&) = delete;
+        auto operator=(mapped_file const&) -> mapped_file& = delete;
+
+        ~mapped_file() {
+            if(_data != nullptr)
+            {
+                ::munmap(const_cast<char*>(_data), _size);
+            }
+        }
+
+        auto view() const -> std::string_view {
+            return _data == nullptr ? std::string_view() : std::string_view(_data, _size);
+        }
+
+    private:
+        char const* _data = nullptr;
+        std::size_t _size = 0;
+    };
+#else
+    /**
+     * @brief Whole file content, read in memory where memory mappings are not available
+     */
+    class mapped_file
+    {
+    public:
+        /**
+         * @throws std::system_error if the file cannot be read
+         */
+        explicit mapped_file(std::filesystem::path const& path) {
+            std::ifstream in(path, std::ios::binary);
+            if(!in)
+            {
+                throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory), "json file: cannot open " + path.string());
+            }
+            _content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+
+        auto view() const -> std::string_view {
+            return _content;
+        }
+
+    private:
+        std::string _content;
+    };
+#endif
+
+    /**
+     * @brief A T decoded from a file together with what its borrowed and lazy members view: the mapping of
+     * the file and the arena holding the unescaped copies of its escaped strings
+     *
+     * Both are held on the heap, so the document can be moved without invalidating the views.
+     */
+    template<typename T>
+    class mapped_document
+    {
+    public:
+        mapped_document(std::unique_ptr<mapped_file const> file, std::unique_ptr<std::pmr::monotonic_buffer_resource> arena, T value) :
+            _file(std::move(file)),
+            _arena(std::move(arena)),
+            _value(std::move(value))
+        {}
+
+        auto operator*() -> T& {
+            return _value;
+        }
+
+        auto operator*() const -> T const& {
+            return _value;
+        }
+
+        auto operator->() -> T* {
+            return &_value;
+        }
+
+        auto operator->() const -> T const* {
+            return &_value;
+        }
+
+    private:
+        std::unique_ptr<mapped_file const> _file;
+        std::unique_ptr<std::pmr::monotonic_buffer_resource> _arena;
+        T _value;// declared last: destroyed before what it views
+    };
+}
+
+/**
+ * @brief Decode the json file at path straight from a memory mapping of it, without copying it into a string
+ *
+ * @throws std::system_error if the file cannot be read
+ * @throws nlohmann::json::parse_error, nlohmann::json::out_of_range, nlohmann::json::type_error like read_json<T, Registry>
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto from_json_file(std::filesystem::path const& path) -> T {
+    static_assert(!dori::json::borrows_input_v<T, Registry>, "the mapping is released on return, decode std::string_view, std::span<char const> and lazy members with from_json_file_borrowed");
+    dori::json::mapped_file const file(path);
+    return read_json<T, Registry>(file.view());
+}
+
+/**
+ * @brief Decode the json file at path into a T whose std::string_view, std::span<char const> and lazy members
+ * view the memory mapping of the file, returned along with the mapping it keeps alive
+ *
+ * Escaped borrowed strings are unescaped into an arena owned by the returned document, as are std::pmr members.
+ * @throws std::system_error if the file cannot be read
+ * @throws nlohmann::json::parse_error, nlohmann::json::out_of_range, nlohmann::json::type_error like read_json<T, Registry>
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto from_json_file_borrowed(std::filesystem::path const& path) -> dori::json::mapped_document<T> {
+    auto file = std::make_unique<dori::json::mapped_file const>(path);
+    auto arena = std::make_unique<std::pmr::monotonic_buffer_resource>();
+    auto value = from_json_borrowed<T, Registry>(file->view(), arena.get());
+    return dori::json::mapped_document<T>(std::move(file), std::move(arena), std::move(value));
+}
+
+/**
+ * @brief Write the json text of b to the file at path (created or truncated), streamed in large blocks instead of built in memory
+ *
+ * The file content is byte-identical to to_json<T, Registry>(b).
+ * @throws std::system_error (std::ios_base::failure without POSIX files) if the file cannot be written
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto to_json_file(T const& b, std::filesystem::path const& path) -> void {
+#if defined(DORI_JSON_HAS_MMAP)
+    dori::json::unique_fd fd(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+    if(fd.get() < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "json file: cannot open " + path.string());
+    }
+    dori::json::fd_sink sink(fd.get());
+#else
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if(!out)
+    {
+        throw std::ios_base::failure("json file: cannot open " + path.string());
+    }
+    dori::json::ostream_sink sink(out);
+#endif
+
+    dori::json::block_buffer buffer(sink);
+    write_json<T, Registry>(b, buffer, {.format = dori::json::text_format::dom});
+    buffer.flush();
+
+#if defined(DORI_JSON_HAS_MMAP)
+    fd.close();
+#else
+    out.close();
+    if(!out)
+    {
+        throw std::ios_base::failure("json file: cannot write " + path.string());
+    }
+#endif
+}
@@ -0,0 +1,244 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <concepts>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <nlohmann/json.hpp>
+
+/**
+ * Number conversions keyed on the exact member type (int8_t ... uint64_t, float, double).
+ *
+ * Integers are range checked instead of going through an int, 64 bits values keep all their digits,
+ * and floats are parsed and printed with their own precision (std::from_chars / std::to_chars).
+ */
+namespace dori::json
+{
+    namespace detail
+    {
+        /**
+         * @brief Convert an integral valued double to I, failing on fractions and on values I cannot hold
+         */
+        template<std::integral I>
+        auto integer_from_double(double const d, I& value) -> std::errc {
+            if(std::trunc(d) != d)
+            {
+                return std::errc::invalid_argument;
+            }
+            if(d < static_cast<double>(std::numeric_limits<I>::min()) || d >= std::ldexp(1.0, std::numeric_limits<I>::digits))
+            {
+                return std::errc::result_out_of_range;
+            }
+            value = static_cast<I>(d);
+            return std::errc();
+        }
+
+        /**
+         * @brief std::in_range, extended to the character types of I
+         */
+        template<std::integral I, std::integral V>
+        auto in_range(V const v) -> bool {
+            using standard = std::conditional_t<std::is_signed_v<I>, std::make_signed_t<I>, std::make_unsigned_t<I>>;
+            return std::in_range<standard>(v);
+        }
+
+        /**
+         * @brief Whether an out of range token is too small (and rounds to zero) rather than too large
+         */
+        inline auto is_underflow(std::string_view const token) -> bool {
+            auto const exponent = token.find_first_of("eE");
+            if(exponent != std::string_view::npos)
+            {
+                return exponent + 1 < token.size() && token[exponent + 1] == '-';
+            }
+            return token.starts_with("0.") || token.starts_with("-0.");
+        }
+    }
+
+    /**
+     * @brief Parse a validated json number token into exactly I
+     *
+     * @param integral_token whether the token has neither fraction nor exponent; other tokens
+     *                       are accepted when they hold an integral value, like 1.0 or 1e3
+     * @return std::errc::result_out_of_range if I cannot hold the value, std::errc::invalid_argument if it is not integral
+     */
+    template<std::integral I> requires(!std::is_same_v<I, bool>)
+    auto parse_integer(std::string_view const token, bool const integral_token, I& value) -> std::errc {
+        if(integral_token)
+        {
+            if constexpr(std::is_unsigned_v<I>)
+            {
+                if(token.starts_with('-'))
+                {
+                    return token == "-0" ? (value = 0, std::errc()) : std::errc::result_out_of_range;
+                }
+            }
+            auto const result = std::from_chars(token.data(), token.data() + token.size(), value);
+            return result.ec;
+        }
+
+        double d = 0;
+        auto const result = std::from_chars(token.data(), token.data() + token.size(), d);
+        if(result.ec != std::errc())
+        {
+            return std::errc::result_out_of_range;
+        }
+        return detail::integer_from_double(d, value);
+    }
+
+    /**
+     * @brief Parse a validated json number token into exactly F, rounding once to F's precision
+     *
+     * Values too small for F become a signed zero.
+     * @return std::errc::result_out_of_range if the value is too large for F
+     */
+    template<std::floating_point F>
+    auto parse_float(std::string_view const token, F& value) -> std::errc {
+        auto const result = std::from_chars(token.data(), token.data() + token.size(), value);
+        if(result.ec == std::errc::result_out_of_range && detail::is_underflow(token))
+        {
+            value = token.starts_with('-') ? -F(0) : F(0);
+            return std::errc();
+        }
+        return result.ec;
+    }
+
+    /**
+     * @brief Format a finite float with its shortest round-trip digits into out, returns the end of the written characters
+     *
+     * The layout is the one nlohmann::json uses for doubles: fixed notation for decimal exponents in ]-4, 15],
+     * scientific otherwise, and a trailing ".0" on integral values.
+     */
+    template<std::floating_point F>
+    auto format_float(char* out, F const value) -> char* {
+        if(std::signbit(value))
+        {
+            *out++ = '-';
+        }
+        if(value == 0)
+        {
+            *out++ = '0';
+            *out++ = '.';
+            *out++ = '0';
+            return out;
+        }
+
+        // d[.ddd]e(+|-)xx
+        std::array<char, 64> scientific;
+        auto const result = std::to_chars(scientific.data(), scientific.data() + scientific.size(), std::fabs(value), std::chars_format::scientific);
+
+        std::array<char, 48> digits;
+        int k = 0;
+        char const* it = scientific.data();
+        for(; *it != 'e'; ++it)
+        {
+            if(*it != '.')
+            {
+                digits[k++] = *it;
+            }
+        }
+        int exponent = 0;
+        std::from_chars(it + (it[1] == '+' ? 2 : 1), result.ptr, exponent);
+
+        constexpr int min_exp = -4;
+        constexpr int max_exp = 15;
+        int const n = exponent + 1;
+
+        if(k <= n && n <= max_exp)
+        {
+            out = std::copy_n(digits.data(), k, out);
+            out = std::fill_n(out, n - k, '0');
+            *out++ = '.';
+            *out++ = '0';
+            return out;
+        }
+        if(0 < n && n <= max_exp)
+        {
+            out = std::copy_n(digits.data(), n, out);
+            *out++ = '.';
+            return std::copy_n(digits.data() + n, k - n, out);
+        }
+        if(min_exp < n && n <= 0)
+        {
+            *out++ = '0';
+            *out++ = '.';
+            out = std::fill_n(out, -n, '0');
+            return std::copy_n(digits.data(), k, out);
+        }
+
+        *out++ = digits[0];
+        if(k > 1)
+        {
+            *out++ = '.';
+            out = std::copy_n(digits.data() + 1, k - 1, out);
+        }
+        *out++ = 'e';
+        *out++ = exponent < 0 ? '-' : '+';
+        int const e = exponent < 0 ? -exponent : exponent;
+        if(e < 10)
+        {
+            *out++ = '0';
+        }
+        return std::to_chars(out, out + 4, e).ptr;
+    }
+
+    /**
+     * @brief Read a nlohmann::json number as exactly T
+     *
+     * @throws nlohmann::json::type_error if node is not a number, or not an integral one for an integral T
+     * @throws nlohmann::json::out_of_range if T cannot hold the value
+     */
+    template<typename T> requires(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+    auto get_number(nlohmann::json const& node) -> T {
+        if(!node.is_number())
+        {
+            throw nlohmann::json::type_error::create(302, "type must be number, but is " + std::string(node.type_name()), &node);
+        }
+
+        if constexpr(std::is_floating_point_v<T>)
+        {
+            auto const d = node.get<double>();
+            if(std::isfinite(d) && std::fabs(d) > static_cast<double>(std::numeric_limits<T>::max()))
+            {
+                throw nlohmann::json::out_of_range::create(406, "number overflow: " + node.dump(), &node);
+            }
+            return static_cast<T>(d);
+        }
+        else
+        {
+            T value{};
+            std::errc ec;
+            if(node.is_number_unsigned())
+            {
+                auto const v = node.get<std::uint64_t>();
+                ec = detail::in_range<T>(v) ? (value = static_cast<T>(v), std::errc()) : std::errc::result_out_of_range;
+            }
+            else if(node.is_number_integer())
+            {
+                auto const v = node.get<std::int64_t>();
+                ec = detail::in_range<T>(v) ? (value = static_cast<T>(v), std::errc()) : std::errc::result_out_of_range;
+            }
+            else
+            {
+                ec = detail::integer_from_double(node.get<double>(), value);
+            }
+
+            if(ec == std::errc::result_out_of_range)
+            {
+                throw nlohmann::json::out_of_range::create(406, "number overflow: " + node.dump(), &node);
+            }
+            if(ec != std::errc())
+            {
+                throw nlohmann::json::type_error::create(302, "type must be an integral number, but is " + node.dump(), &node);
+            }
+            return value;
+        }
+    }
+}
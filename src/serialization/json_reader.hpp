@@ -0,0 +1,955 @@
+#pragma once
+#include <array>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <nlohmann/json.hpp>
+
+#include "json_number.hpp"
+#include "string_kernels.hpp"
+
+namespace dori::json
+{
+    enum class error_kind
+    {
+        none,
+        unexpected_end,
+        unexpected_character,
+        invalid_literal,
+        invalid_number,
+        number_out_of_range,
+        invalid_string,
+        missing_field,
+        type_mismatch,
+        unborrowable_string,
+        too_deep
+    };
+
+    /**
+     * @brief Pull reader over a json text, decoding tokens in place without building a DOM
+     *
+     * The reader never throws: every read returns false on failure and records the first error
+     * (its kind and byte offset), callers just propagate the false upward.
+     */
+    class reader
+    {
+    public:
+
+        /**
+         * @brief Deepest nesting of objects and arrays accepted, deeper input fails with too_deep instead of
+         * overflowing the stack of the recursive descent
+         */
+        static constexpr std::size_t max_depth = 512;
+
+        explicit reader(std::string_view const input) :
+            _begin(input.data()),
+            _current(input.data()),
+            _end(input.data() + input.size())
+        {}
+
+        /**
+         * @param resource where decoded std::pmr members and the reader scratch buffer allocate
+         */
+        reader(std::string_view const input, std::pmr::memory_resource* const resource) :
+            _begin(input.data()),
+            _current(input.data()),
+            _end(input.data() + input.size()),
+            _resource(resource),
+            _scratch(resource != nullptr ? resource : std::pmr::get_default_resource())
+        {}
+
+        /**
+         * @brief The memory resource decoded std::pmr members must use, nullptr to leave them as constructed
+         */
+        auto resource() const -> std::pmr::memory_resource* {
+            return _resource;
+        }
+
+        auto position() const -> std::size_t {
+            return static_cast<std::size_t>(_current - _begin);
+        }
+
+        auto error() const -> error_kind {
+            return _error;
+        }
+
+        auto error_offset() const -> std::size_t {
+            return _error_offset;
+        }
+
+        /**
+         * @brief Name of the missing field when error() is error_kind::missing_field
+         */
+        auto error_field() const -> std::string_view {
+            return _error_field;
+        }
+
+        /**
+         * @brief Record the first error and return false so it can be propagated with a single return
+         */
+        auto fail(error_kind const kind) -> bool {
+            if(_error == error_kind::none)
+            {
+                _error = kind;
+                _error_offset = position();
+            }
+            return false;
+        }
+
+        auto fail_missing_field(std::string_view const name) -> bool {
+            if(_error == error_kind::none)
+            {
+                _error_field = name;
+                fail(error_kind::missing_field);
+                return trace_member(name);
+            }
+            return false;
+        }
+
+        /**
+         * @brief Json pointer (RFC 6901) to the value where the error occurred, built while the failure unwinds
+         */
+        auto error_path() const -> std::string_view {
+            return _error_path;
+        }
+
+        /**
+         * @brief Prepend the object member key to the error path and return false, called while a failure unwinds out of key
+         */
+        auto trace_member(std::string_view const key) -> bool {
+            std::string segment = "/";
+            for(char const c : key)
+            {
+                if(c == '~')
+                {
+                    segment += "~0";
+                }
+                else if(c == '/')
+                {
+                    segment += "~1";
+                }
+                else
+                {
+                    segment += c;
+                }
+            }
+            _error_path.insert(0, segment);
+            return false;
+        }
+
+        /**
+         * @brief Prepend the array element index to the error path and return false, called while a failure unwinds out of it
+         */
+        auto trace_element(std::size_t const index) -> bool {
+            std::string segment = "/";
+            segment += std::to_string(index);
+            _error_path.insert(0, segment);
+            return false;
+        }
+
+        /**
+         * @brief Fail with type_mismatch if the next token is a valid value of another type, or with a syntax error otherwise
+         */
+        auto fail_type() -> bool {
+            switch(peek())
+            {
+                case '{': case '[': case '"': case 't': case 'f': case 'n': case '-':
+                case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
+                    return fail(error_kind::type_mismatch);
+                case '\0':
+                    return at_end() ? fail(error_kind::unexpected_end) : fail(error_kind::unexpected_character);
+                default:
+                    return fail(error_kind::unexpected_character);
+            }
+        }
+
+        auto skip_whitespace() -> void {
+            _current = kernels::skip_whitespace(_current, _end);
+        }
+
+        auto at_end() const -> bool {
+            return _current == _end;
+        }
+
+        /**
+         * @brief Skip whitespaces and return the next character without consuming it, '\0' at the end of the input
+         */
+        auto peek() -> char {
+            skip_whitespace();
+            return at_end() ? '\0' : *_current;
+        }
+
+        auto consume(char const c) -> bool {
+            if(peek() == c && !at_end())
+            {
+                ++_current;
+                return true;
+            }
+            return false;
+        }
+
+        auto expect(char const c) -> bool {
+            if(consume(c))
+            {
+                return true;
+            }
+            return at_end() ? fail(error_kind::unexpected_end) : fail(error_kind::unexpected_character);
+        }
+
+        /**
+         * @brief Succeeds if only whitespaces remain
+         */
+        auto finish() -> bool {
+            skip_whitespace();
+            return at_end() || fail(error_kind::unexpected_character);
+        }
+
+        auto read_null() -> bool {
+            if(peek() != 'n')
+            {
+                return fail_type();
+            }
+            return read_literal("null");
+        }
+
+        auto read_bool(bool& value) -> bool {
+            switch(peek())
+            {
+                case 't':
+                    value = true;
+                    return read_literal("true");
+                case 'f':
+                    value = false;
+                    return read_literal("false");
+                default:
+                    return fail_type();
+            }
+        }
+
+        /**
+         * @brief Read a json number token, validating its grammar
+         *
+         * @param integral set to true when the token has neither fraction nor exponent
+         */
+        auto read_number(std::string_view& token, bool& integral) -> bool {
+            char const c = peek();
+            if(c != '-' && (c < '0' || c > '9'))
+            {
+                return fail_type();
+            }
+
+            char const* const start = _current;
+            integral = true;
+
+            if(*_current == '-')
+            {
+                ++_current;
+            }
+            if(at_end() || !is_digit(*_current))
+            {
+                return fail(error_kind::invalid_number);
+            }
+            if(*_current == '0')
+            {
+                ++_current;
+            }
+            else
+            {
+                skip_digits();
+            }
+            if(!at_end() && *_current == '.')
+            {
+                integral = false;
+                ++_current;
+                if(at_end() || !is_digit(*_current))
+                {
+                    return fail(error_kind::invalid_number);
+                }
+                skip_digits();
+            }
+            if(!at_end() && (*_current == 'e' || *_current == 'E'))
+            {
+                integral = false;
+                ++_current;
+                if(!at_end() && (*_current == '+' || *_current == '-'))
+                {
+                    ++_current;
+                }
+                if(at_end() || !is_digit(*_current))
+                {
+                    return fail(error_kind::invalid_number);
+                }
+                skip_digits();
+            }
+
+            token = std::string_view(start, _current - start);
+            return true;
+        }
+
+        /**
+         * @brief Read a number into exactly I, failing with number_out_of_range if I cannot hold it
+         *
+         * Non integral tokens are accepted when they hold an integral value (1.0, 1e3).
+         */
+        template<std::integral I> requires(!std::is_same_v<I, bool>)
+        auto read_integer(I& value) -> bool {
+            std::string_view token;
+            bool integral = false;
+            if(!read_number(token, integral))
+            {
+                return false;
+            }
+            auto const ec = parse_integer(token, integral, value);
+            if(ec == std::errc())
+            {
+                return true;
+            }
+            return fail(ec == std::errc::result_out_of_range ? error_kind::number_out_of_range : error_kind::type_mismatch);
+        }
+
+        /**
+         * @brief Read a number into exactly F, failing with number_out_of_range if it is too large for F
+         */
+        template<std::floating_point F>
+        auto read_float(F& value) -> bool {
+            std::string_view token;
+            bool integral = false;
+            if(!read_number(token, integral))
+            {
+                return false;
+            }
+            return parse_float(token, value) == std::errc() || fail(error_kind::number_out_of_range);
+        }
+
+        /**
+         * @brief Read a string value, unescaping it into value
+         */
+        template<typename Traits, typename Alloc>
+        auto read_string(std::basic_string<char, Traits, Alloc>& value) -> bool {
+            if(peek() != '"')
+            {
+                return fail_type();
+            }
+            ++_current;
+            value.clear();
+            return read_string_content(value);
+        }
+
+        /**
+         * @brief Read a string value as a view instead of a copy
+         *
+         * Strings without escapes are viewed in place in the input. Escaped strings are unescaped into memory
+         * allocated from resource(), and fail with unborrowable_string when the reader has no resource.
+         */
+        auto read_string_view(std::string_view& value) -> bool {
+            if(peek() != '"')
+            {
+                return fail_type();
+            }
+            ++_current;
+
+            char const* const start = _current;
+            _current = kernels::find_escape(_current, _end);
+            if(_current != _end && *_current == '"')
+            {
+                value = std::string_view(start, _current - start);
+                ++_current;
+                return true;
+            }
+            if(_resource == nullptr && _current != _end && *_current == '\\')
+            {
+                return fail(error_kind::unborrowable_string);
+            }
+
+            _scratch.assign(start, _current);
+            if(!read_string_content(_scratch))
+            {
+                return false;
+            }
+            auto* const copy = static_cast<char*>(_resource->allocate(_scratch.size(), alignof(char)));
+            std::char_traits<char>::copy(copy, _scratch.data(), _scratch.size());
+            value = std::string_view(copy, _scratch.size());
+            return true;
+        }
+
+        /**
+         * @brief Read an object key and the following ':'
+         *
+         * The key views the input when it has no escape, or otherwise a buffer owned by the
+         * current depth, so it stays valid while the member value is read and until the next key
+         * of the same object.
+         */
+        auto read_key(std::string_view& key) -> bool {
+            if(peek() != '"')
+            {
+                return at_end() ? fail(error_kind::unexpected_end) : fail(error_kind::unexpected_character);
+            }
+            ++_current;
+
+            char const* const start = _current;
+            _current = kernels::find_escape(_current, _end);
+            if(_current != _end && *_current == '"')
+            {
+                key = std::string_view(start, _current - start);
+                ++_current;
+            }
+            else
+            {
+                std::pmr::string& buffer = key_buffer();
+                buffer.assign(start, _current);
+                if(!read_string_content(buffer))
+                {
+                    return false;
+                }
+                key = buffer;
+            }
+            return expect(':');
+        }
+
+        /**
+         * @brief Read an object, calling on_member(key) with the reader positioned on each member value
+         *
+         * on_member must consume the value and return false on failure.
+         */
+        template<typename OnMember>
+        auto read_object(OnMember&& on_member) -> bool {
+            if(peek() != '{')
+            {
+                return fail_type();
+            }
+            if(!enter())
+            {
+                return false;
+            }
+            ++_current;
+            if(!consume('}'))
+            {
+                do
+                {
+                    std::string_view key;
+                    if(!read_key(key) || !on_member(key))
+                    {
+                        return false;
+                    }
+                }
+                while(consume(','));
+
+                if(!expect('}'))
+                {
+                    return false;
+                }
+            }
+            --_depth;
+            return true;
+        }
+
+        /**
+         * @brief Read an array, calling on_element() with the reader positioned on each element
+         *
+         * on_element must consume the element and return false on failure.
+         */
+        template<typename OnElement>
+        auto read_array(OnElement&& on_element) -> bool {
+            if(peek() != '[')
+            {
+                return fail_type();
+            }
+            if(!enter())
+            {
+                return false;
+            }
+            ++_current;
+            if(!consume(']'))
+            {
+                do
+                {
+                    if(!on_element())
+                    {
+                        return false;
+                    }
+                }
+                while(consume(','));
+
+                if(!expect(']'))
+                {
+                    return false;
+                }
+            }
+            --_depth;
+            return true;
+        }
+
+        /**
+         * @brief Skip any json value, validating it
+         */
+        auto skip_value() -> bool {
+            switch(peek())
+            {
+                case '{':
+                    return read_object([this](std::string_view) { return skip_value(); });
+                case '[':
+                    return read_array([this] { return skip_value(); });
+                case '"':
+                {
+                    ++_current;
+                    discard ignored;
+                    return read_string_content(ignored);
+                }
+                case 't':
+                case 'f':
+                {
+                    bool value;
+                    return read_bool(value);
+                }
+                case 'n':
+                    return read_null();
+                default:
+                {
+                    std::string_view token;
+                    bool integral;
+                    return read_number(token, integral);
+                }
+            }
+        }
+
+        /**
+         * @brief Skip any json value with a bracket-matching scan and return its text in raw
+         *
+         * Objects and arrays are only scanned for their closing bracket (strings are stepped over, so
+         * brackets inside them do not count): each closing bracket must match the kind of the one it closes,
+         * but the rest of the content is not validated, decoding raw later reports any error. Scalars are
+         * validated as by skip_value.
+         */
+        auto read_raw(std::string_view& raw) -> bool {
+            char const c = peek();
+            char const* const start = _current;
+            if(c != '{' && c != '[')
+            {
+                if(!skip_value())
+                {
+                    return false;
+                }
+                raw = std::string_view(start, _current - start);
+                return true;
+            }
+
+            // one bit per open bracket, set for '{', so the closing one can be checked against it
+            std::array<std::uint64_t, max_depth / 64> objects{};
+            std::size_t depth = _depth;
+            do
+            {
+                while(_current != _end && !is_structural(*_current))
+                {
+                    ++_current;
+                }
+                if(_current == _end)
+                {
+                    return fail(error_kind::unexpected_end);
+                }
+                switch(char const bracket = *_current++; bracket)
+                {
+                    case '"':
+                        if(!skip_string())
+                        {
+                            return false;
+                        }
+                        break;
+                    case '{':
+                    case '[':
+                        if(depth == max_depth)
+                        {
+                            --_current;
+                            return fail(error_kind::too_deep);
+                        }
+                        if(bracket == '{')
+                        {
+                            objects[depth / 64] |= std::uint64_t(1) << (depth % 64);
+                        }
+                        else
+                        {
+                            objects[depth / 64] &= ~(std::uint64_t(1) << (depth % 64));
+                        }
+                        ++depth;
+                        break;
+                    default:
+                        --depth;
+                        if(((objects[depth / 64] >> (depth % 64)) & 1) != (bracket == '}' ? 1u : 0u))
+                        {
+                            --_current;
+                            return fail(error_kind::unexpected_character);
+                        }
+                        break;
+                }
+            }
+            while(depth != _depth);
+
+            raw = std::string_view(start, _current - start);
+            return true;
+        }
+
+    private:
+
+        /**
+         * @brief String sink used to validate a string without storing it
+         */
+        struct discard
+        {
+            auto append(char const*, char const*) -> void {}
+            auto push_back(char) -> void {}
+        };
+
+        static auto is_digit(char const c) -> bool {
+            return c >= '0' && c <= '9';
+        }
+
+        /**
+         * @brief Count one more level of nesting, failing with too_deep past max_depth
+         */
+        auto enter() -> bool {
+            return ++_depth <= max_depth || fail(error_kind::too_deep);
+        }
+
+        static auto is_structural(char const c) -> bool {
+            return c == '"' || c == '{' || c == '}' || c == '[' || c == ']';
+        }
+
+        /**
+         * @brief Step over the rest of a string up to its closing quote, without checking its escapes
+         */
+        auto skip_string() -> bool {
+            while(true)
+            {
+                _current = kernels::find_escape(_current, _end);
+                if(_current == _end)
+                {
+                    return fail(error_kind::unexpected_end);
+                }
+                switch(*_current++)
+                {
+                    case '"':
+                        return true;
+                    case '\\':
+                        if(_current == _end)
+                        {
+                            return fail(error_kind::unexpected_end);
+                        }
+                        ++_current;
+                        break;
+                    default:
+                        return fail(error_kind::invalid_string);
+                }
+            }
+        }
+
+        auto skip_digits() -> void {
+            while(_current != _end && is_digit(*_current))
+            {
+                ++_current;
+            }
+        }
+
+        auto read_literal(std::string_view const literal) -> bool {
+            if(static_cast<std::size_t>(_end - _current) < literal.size() || std::string_view(_current, literal.size()) != literal)
+            {
+                return fail(error_kind::invalid_literal);
+            }
+            _current += literal.size();
+            return true;
+        }
+
+        /**
+         * @brief Append the unescaped characters up to the closing quote (excluded) to value
+         */
+        template<typename String>
+        auto read_string_content(String& value) -> bool {
+            while(true)
+            {
+                char const* const run = _current;
+                _current = kernels::find_escape(_current, _end);
+                value.append(run, _current);
+
+                if(_current == _end)
+                {
+                    return fail(error_kind::unexpected_end);
+                }
+                if(*_current == '"')
+                {
+                    ++_current;
+                    return true;
+                }
+                if(*_current != '\\')
+                {
+                    return fail(error_kind::invalid_string);
+                }
+                ++_current;
+                if(!read_escape(value))
+                {
+                    return false;
+                }
+            }
+        }
+
+        template<typename String>
+        auto read_escape(String& value) -> bool {
+            if(_current == _end)
+            {
+                return fail(error_kind::unexpected_end);
+            }
+            switch(*_current++)
+            {
+                case '"':  value.push_back('"'); return true;
+                case '\\': value.push_back('\\'); return true;
+                case '/':  value.push_back('/'); return true;
+                case 'b':  value.push_back('\b'); return true;
+                case 'f':  value.push_back('\f'); return true;
+                case 'n':  value.push_back('\n'); return true;
+                case 'r':  value.push_back('\r'); return true;
+                case 't':  value.push_back('\t'); return true;
+                case 'u':  break;
+                default:   return fail(error_kind::invalid_string);
+            }
+
+            std::uint32_t codepoint = 0;
+            if(!read_hex4(codepoint))
+            {
+                return false;
+            }
+            if(codepoint >= 0xD800 && codepoint <= 0xDBFF)
+            {
+                std::uint32_t low = 0;
+                if(_end - _current < 2 || _current[0] != '\\' || _current[1] != 'u')
+                {
+                    return fail(error_kind::invalid_string);
+                }
+                _current += 2;
+                if(!read_hex4(low) || low < 0xDC00 || low > 0xDFFF)
+                {
+                    return fail(error_kind::invalid_string);
+                }
+                codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+            }
+            else if(codepoint >= 0xDC00 && codepoint <= 0xDFFF)
+            {
+                return fail(error_kind::invalid_string);
+            }
+
+            append_utf8(value, codepoint);
+            return true;
+        }
+
+        auto read_hex4(std::uint32_t& codepoint) -> bool {
+            if(_end - _current < 4)
+            {
+                return fail(error_kind::unexpected_end);
+            }
+            for(int i = 0; i < 4; ++i)
+            {
+                char const c = *_current++;
+                codepoint <<= 4;
+                if(c >= '0' && c <= '9')      codepoint |= static_cast<std::uint32_t>(c - '0');
+                else if(c >= 'a' && c <= 'f') codepoint |= static_cast<std::uint32_t>(c - 'a' + 10);
+                else if(c >= 'A' && c <= 'F') codepoint |= static_cast<std::uint32_t>(c - 'A' + 10);
+                else return fail(error_kind::invalid_string);
+            }
+            return true;
+        }
+
+        template<typename String>
+        static auto append_utf8(String& value, std::uint32_t const codepoint) -> void {
+            if(codepoint < 0x80)
+            {
+                value.push_back(static_cast<char>(codepoint));
+            }
+            else if(codepoint < 0x800)
+            {
+                value.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+                value.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+            }
+            else if(codepoint < 0x10000)
+            {
+                value.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+                value.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+                value.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+            }
+            else
+            {
+                value.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+                value.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+                value.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+                value.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+            }
+        }
+
+        /**
+         * @brief Buffer for the escaped keys read at the current depth
+         *
+         * Created on the first escaped key, as a deque so that adding a depth never moves the
+         * keys still viewed by the enclosing objects.
+         */
+        auto key_buffer() -> std::pmr::string& {
+            if(!_keys)
+            {
+                _keys.emplace(_scratch.get_allocator());
+            }
+            while(_keys->size() <= _depth)
+            {
+                _keys->emplace_back();
+            }
+            return (*_keys)[_depth];
+        }
+
+        char const* _begin;
+        char const* _current;
+        char const* _end;
+        std::pmr::memory_resource* _resource = nullptr;
+        std::pmr::string _scratch;
+        std::optional<std::pmr::deque<std::pmr::string>> _keys;
+        std::size_t _depth = 0;
+        error_kind _error = error_kind::none;
+        std::size_t _error_offset = 0;
+        std::string_view _error_field;
+        std::string _error_path;
+    };
+
+    /**
+     * @brief Find where a json value ends in a text that arrives in pieces, with a bracket-matching scan
+     * resumed where the previous call stopped
+     *
+     * Like reader::read_raw, the content is not validated. A scalar ends at the first ',', ']', '}' or
+     * whitespace after it, so it is only complete once the character following it has arrived.
+     */
+    class value_scanner
+    {
+    public:
+        static constexpr std::size_t npos = std::string_view::npos;
+
+        /**
+         * @param text the value followed by what arrived so far, extending the text of the previous calls
+         * @return the length of the value once complete, npos while it needs more text
+         */
+        auto scan(std::string_view const text) -> std::size_t {
+            if(_scanned == 0 && !text.empty())
+            {
+                _scalar = text[0] != '{' && text[0] != '[' && text[0] != '"';
+            }
+            for(; _scanned < text.size(); ++_scanned)
+            {
+                char const c = text[_scanned];
+                if(_in_string)
+                {
+                    if(_escaped)
+                    {
+                        _escaped = false;
+                    }
+                    else if(c == '\\')
+                    {
+                        _escaped = true;
+                    }
+                    else if(c == '"')
+                    {
+                        _in_string = false;
+                        if(_depth == 0)
+                        {
+                            return ++_scanned;
+                        }
+                    }
+                }
+                else if(_scalar)
+                {
+                    if(c == ',' || c == ']' || c == '}' || kernels::scalar::is_whitespace(c))
+                    {
+                        return _scanned;
+                    }
+                }
+                else if(c == '"')
+                {
+                    _in_string = true;
+                }
+                else if(c == '{' || c == '[')
+                {
+                    ++_depth;
+                }
+                else if((c == '}' || c == ']') && --_depth == 0)
+                {
+                    return ++_scanned;
+                }
+            }
+            return npos;
+        }
+
+        auto reset() -> void {
+            *this = value_scanner();
+        }
+
+    private:
+        std::size_t _scanned = 0;
+        std::size_t _depth = 0;
+        bool _scalar = false;
+        bool _in_string = false;
+        bool _escaped = false;
+    };
+
+    /**
+     * @brief Decoding failure reported without exception
+     */
+    struct error
+    {
+        error_kind kind = error_kind::none;
+        /**
+         * @brief Byte offset of the error in the input, from 0
+         */
+        std::size_t offset = 0;
+        /**
+         * @brief Json pointer (RFC 6901) to the value that failed, e.g. "/data/0/1/token"
+         */
+        std::string path;
+    };
+
+    inline auto make_error(reader const& r) -> error {
+        return error{.kind = r.error(), .offset = r.error_offset(), .path = std::string(r.error_path())};
+    }
+
+    /**
+     * @brief Throw the nlohmann::json exception matching the reader error, so the native decode
+     * path keeps the same contract as nlohmann::json::parse + at()
+     * @param base offset of the reader input in the whole json text, added to the reported byte
+     *
+     * @throws nlohmann::json::parse_error on malformed json
+     * @throws nlohmann::json::out_of_range if a reflected field is missing
+     * @throws nlohmann::json::type_error if a value has not the reflected type, or is an escaped string borrowed without arena
+     */
+    [[noreturn]] inline auto throw_error(reader const& r, std::size_t const base = 0) -> void {
+        auto const byte = base + r.error_offset() + 1;
+        switch(r.error())
+        {
+            case error_kind::missing_field:
+                throw nlohmann::json::out_of_range::create(403, "key '" + std::string(r.error_field()) + "' not found", nullptr);
+            case error_kind::type_mismatch:
+                throw nlohmann::json::type_error::create(302, "unexpected value type at byte " + std::to_string(byte), nullptr);
+            case error_kind::unborrowable_string:
+                throw nlohmann::json::type_error::create(302, "escaped string at byte " + std::to_string(byte) + " cannot be borrowed without an arena", nullptr);
+            case error_kind::unexpected_end:
+                throw nlohmann::json::parse_error::create(101, byte, "syntax error: unexpected end of input", nullptr);
+            case error_kind::invalid_literal:
+                throw nlohmann::json::parse_error::create(101, byte, "syntax error: invalid literal", nullptr);
+            case error_kind::number_out_of_range:
+                throw nlohmann::json::out_of_range::create(406, "number overflow at byte " + std::to_string(byte), nullptr);
+            case error_kind::invalid_number:
+                throw nlohmann::json::parse_error::create(101, byte, "syntax error: invalid number", nullptr);
+            case error_kind::invalid_string:
+                throw nlohmann::json::parse_error::create(101, byte, "syntax error: invalid string", nullptr);
+            case error_kind::too_deep:
+                throw nlohmann::json::parse_error::create(101, byte, "syntax error: nesting deeper than " + std::to_string(reader::max_depth), nullptr);
+            default:
+                throw nlohmann::json::parse_error::create(101, byte, "syntax error: unexpected character", nullptr);
+        }
+    }
+}
@@ -1,18 +1,406 @@
 #pragma once
 #include "serializer.hpp"
 #include "traits.hpp"
+#include "field_table.hpp"
+#include "json_writer.hpp"
+#include "json_reader.hpp"
+#include "lazy.hpp"
+#include "expected.hpp"
+#include "instrumentation.hpp"
 
+#include <cassert>
 #include <string>
 #include <ranges>
 #include <algorithm>
 #include <optional>
+#include <memory>
+#include <memory_resource>
+#include <tuple>
+#include <utility>
 
 #include <refl/refl.hpp>
 #include <refl/registry.hpp>
 #include <nlohmann/json.hpp>
 
-template<refl::meta::reflector reflector>
-class json_serializer : public serializer<json_serializer<reflector>>
+template<typename T, template<typename> typename Registry>
+auto to_json_pair(std::string_view const key, T const& typed_value) -> std::pair<std::string_view, nlohmann::json>;
+
+template<typename T, template<typename> typename Registry>
+auto to_json_value(T const& typed_value) -> decltype(auto);
+
+template<typename T, template<typename> typename Registry>
+auto from_json_value(nlohmann::json const& node) -> decltype(auto);
+
+template<typename T, template<typename> typename Registry, typename Writer>
+auto write_json_value(Writer& writer, T const& typed_value) -> void;
+
+template<typename T, template<typename> typename Registry>
+auto read_json_value(dori::json::reader& reader, T& value) -> bool;
+
+namespace dori::json
+{
+    /**
+     * @brief Read the entries of map, written either as [{"key":value},...] pairs or as a {"key":value,...} object,
+     * reading each value with read_mapped(reader, mapped)
+     *
+     * Decoding into a recycled map reuses its entries: ordered maps are merged with a cursor, vectors of pairs
+     * are overwritten in place then sorted if needed, hashed maps are cleared but keep their buckets.
+     * @return false on failure, the error is recorded in reader
+     */
+    template<typename Map, typename ReadMapped>
+    auto read_map(reader& reader, Map& map, ReadMapped&& read_mapped) -> bool {
+        using key_type = dori::meta::map_key_t<Map>;
+        static_assert(dori::meta::json_map_key<key_type>, "map key type has no json conversion, please specialize dori::meta::map_key");
+
+        auto const read_entries = [&](auto&& on_entry) {
+            if(reader.peek() == '{')
+            {
+                return reader.read_object(on_entry);
+            }
+            std::size_t i = 0;
+            return reader.read_array([&] {
+                ++i;
+                return reader.read_object(on_entry) || reader.trace_element(i - 1);
+            });
+        };
+        auto const parse_key = [&](std::string_view const text, key_type& key) {
+            if constexpr(dori::meta::is_string_v<key_type>)
+            {
+                key.assign(text.data(), text.size());
+                return true;
+            }
+            else
+            {
+                return dori::meta::map_key<key_type>::parse(text, key) || reader.fail(error_kind::type_mismatch);
+            }
+        };
+
+        if constexpr(dori::meta::is_vector_map_v<Map>)
+        {
+            std::size_t size = 0;
+            bool const succeeded = read_entries([&](std::string_view const key) {
+                auto& entry = size < map.size() ? map[size] : map.emplace_back();
+                ++size;
+                return (parse_key(key, entry.first) && read_mapped(reader, entry.second)) || reader.trace_member(key);
+            });
+            map.erase(map.begin() + static_cast<std::ptrdiff_t>(std::min(size, map.size())), map.end());
+            if(!std::ranges::is_sorted(map, {}, &Map::value_type::first))
+            {
+                std::ranges::stable_sort(map, {}, &Map::value_type::first);
+            }
+            return succeeded;
+        }
+        else if constexpr(dori::meta::is_ordered_map_v<Map>)
+        {
+            // merge with a cursor: the writer emits keys in map order, so in steady state each key is the
+            // entry under the cursor and is updated in place. Entries the cursor passes over are stale.
+            // String keys ordered by std::less compare as the text itself, other keys go through key_comp().
+            constexpr bool byte_ordered = dori::meta::is_string_v<key_type> &&
+                                          (std::is_same_v<typename Map::key_compare, std::less<key_type>> || std::is_same_v<typename Map::key_compare, std::less<>>);
+            auto cursor = map.begin();
+            bool const succeeded = read_entries([&](std::string_view const text) {
+                auto entry = cursor;
+                if constexpr(byte_ordered)
+                {
+                    while(cursor != map.end() && std::string_view(cursor->first) < text)
+                    {
+                        cursor = map.erase(cursor);
+                    }
+                    entry = cursor;
+                    if(cursor != map.end() && std::string_view(cursor->first) == text)
+                    {
+                        ++cursor;
+                    }
+                    else
+                    {
+                        entry = map.try_emplace(cursor, key_type(text, map.get_allocator()));
+                    }
+                }
+                else
+                {
+                    key_type key{};
+                    if(!parse_key(text, key))
+                    {
+                        return reader.trace_member(text);
+                    }
+                    auto const less = map.key_comp();
+                    while(cursor != map.end() && less(cursor->first, key))
+                    {
+                        cursor = map.erase(cursor);
+                    }
+                    entry = cursor;
+                    if(cursor != map.end() && !less(key, cursor->first))
+                    {
+                        ++cursor;
+                    }
+                    else
+                    {
+                        entry = map.try_emplace(cursor, std::move(key));
+                    }
+                }
+                return read_mapped(reader, entry->second) || reader.trace_member(text);
+            });
+            map.erase(cursor, map.end());
+            return succeeded;
+        }
+        else
+        {
+            map.clear();
+            return read_entries([&](std::string_view const text) {
+                key_type key{};
+                if constexpr(dori::meta::is_string_v<key_type>)
+                {
+                    key = key_type(text, map.get_allocator());
+                }
+                else if(!parse_key(text, key))
+                {
+                    return reader.trace_member(text);
+                }
+                return read_mapped(reader, map.try_emplace(std::move(key)).first->second) || reader.trace_member(text);
+            });
+        }
+    }
+
+    /**
+     * @brief Convert a json object key into the key of Map
+     * @throws nlohmann::json::type_error if text is not a valid key
+     */
+    template<typename Map>
+    auto to_map_key(std::string const& text) -> dori::meta::map_key_t<Map> {
+        using key_type = dori::meta::map_key_t<Map>;
+        static_assert(dori::meta::json_map_key<key_type>, "map key type has no json conversion, please specialize dori::meta::map_key");
+        if constexpr(dori::meta::is_string_v<key_type>)
+        {
+            return key_type(text);
+        }
+        else
+        {
+            key_type key{};
+            if(!dori::meta::map_key<key_type>::parse(text, key))
+            {
+                throw nlohmann::json::type_error::create(302, "invalid map key '" + text + "'", nullptr);
+            }
+            return key;
+        }
+    }
+
+    /**
+     * @brief Whether T holds, at any depth, members that view the json text they were decoded from:
+     * std::string_view / std::span<char const> members, which borrow it, or lazy<T> members, which defer to it
+     */
+    template<typename T, template<typename> typename Registry>
+    constexpr bool borrows_input_v = [] {
+        if constexpr(dori::meta::is_borrowed_string_v<T> || dori::meta::is_lazy_v<T>)
+        {
+            return true;
+        }
+        else if constexpr(dori::meta::is_optional_v<T>)
+        {
+            return borrows_input_v<typename T::value_type, Registry>;
+        }
+        else if constexpr(std::is_pointer_v<T>)
+        {
+            return false;
+        }
+        else if constexpr(refl::registered<T, Registry>)
+        {
+            return []<std::size_t... I>(std::index_sequence<I...>) {
+                return (borrows_input_v<std::remove_cvref_t<decltype(std::declval<T const&>().*dori::meta::field_at<T, Registry, I>.ptr())>, Registry> || ...);
+            }(std::make_index_sequence<dori::meta::field_count<T, Registry>>{});
+        }
+        else if constexpr(dori::meta::is_map_v<T>)
+        {
+            return borrows_input_v<dori::meta::map_mapped_t<T>, Registry>;
+        }
+        else if constexpr(std::ranges::range<T>)
+        {
+            return borrows_input_v<std::ranges::range_value_t<T>, Registry>;
+        }
+        else
+        {
+            return false;
+        }
+    }();
+
+    /**
+     * @brief A temporary std::string that a decoded T would keep viewing after its destruction, which the
+     * std::string_view entry points refuse
+     */
+    template<typename String, typename T, template<typename> typename Registry>
+    concept dangling_input = std::same_as<std::remove_cv_t<String>, std::string> && borrows_input_v<T, Registry>;
+
+    /**
+     * @brief Whether T is a std::vector of a reflected type, which can be written column by column
+     */
+    template<typename T, template<typename> typename Registry>
+    constexpr bool is_record_vector_v = [] {
+        if constexpr(dori::meta::is_vector_v<T> && !dori::meta::is_map_v<T>)
+        {
+            return std::is_pointer_v<typename T::value_type> == false && refl::registered<typename T::value_type, Registry>;
+        }
+        else
+        {
+            return false;
+        }
+    }();
+
+    /**
+     * @brief Write rows as {"key":[value,...],...}, walking the reflector once per column in the key order of the rows
+     */
+    template<typename T, template<typename> typename Registry, typename Writer, typename Vector>
+    auto write_columns(Writer& writer, Vector const& rows) -> void {
+        using fragments = key_fragments<T, Registry>;
+
+        if constexpr(fragments::size == 0)
+        {
+            writer.write_raw("{}");
+        }
+        else
+        {
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                ([&] {
+                    constexpr auto ptr = dori::meta::field_at<T, Registry, dori::meta::sorted_fields<T, Registry>.index[I]>.ptr();
+                    using field_type = std::remove_cvref_t<decltype(std::declval<T const&>().*ptr)>;
+                    writer.write_raw(fragments::get(I));
+                    writer.put('[');
+                    bool first = true;
+                    for(auto const& row : rows)
+                    {
+                        if(!first)
+                        {
+                            writer.put(',');
+                        }
+                        first = false;
+                        write_json_value<field_type, Registry>(writer, row.*ptr);
+                    }
+                    writer.put(']');
+                }(), ...);
+            }(std::make_index_sequence<fragments::size>{});
+            writer.put('}');
+        }
+    }
+
+    /**
+     * @brief Read rows written as {"key":[value,...],...}, reading the member of declaration index index of each
+     * row with read_field(index, reader, row)
+     *
+     * The first column sets the row count, existing rows are overwritten in place and the leftovers dropped.
+     * Every column must hold that many values, and the columns of the fields for which required(index) holds
+     * must be present.
+     * @return false on failure, the error is recorded in reader
+     */
+    template<typename T, template<typename> typename Registry, typename Vector, typename ReadField, typename Required>
+    auto read_columns(reader& reader, Vector& rows, ReadField&& read_field, Required&& required) -> bool {
+        constexpr auto const& names = dori::meta::field_names<T, Registry>;
+        constexpr auto unknown = static_cast<std::size_t>(-1);
+        std::array<bool, names.size()> seen{};
+        std::size_t expected = dori::meta::first_field<T, Registry>;
+        std::size_t size = unknown;
+
+        bool const succeeded = reader.read_object([&](std::string_view const key) {
+            auto const index = dori::meta::field_index<T, Registry>::find(key, expected);
+            if(index == dori::meta::field_index<T, Registry>::npos)
+            {
+                return reader.skip_value();
+            }
+            seen[index] = true;
+            expected = dori::meta::next_field<T, Registry>[index];
+
+            std::size_t i = 0;
+            bool const column_read = reader.read_array([&] {
+                if(i == size)
+                {
+                    return reader.fail(error_kind::type_mismatch);
+                }
+                auto& row = i < rows.size() ? rows[i] : rows.emplace_back();
+                ++i;
+                return read_field(index, reader, row) || reader.trace_element(i - 1);
+            });
+            if(!column_read)
+            {
+                return reader.trace_member(names[index]);
+            }
+            if(size == unknown)
+            {
+                size = i;
+                rows.erase(rows.begin() + static_cast<std::ptrdiff_t>(size), rows.end());
+            }
+            return i == size || reader.fail(error_kind::type_mismatch) || reader.trace_member(names[index]);
+        });
+
+        if(!succeeded)
+        {
+            return false;
+        }
+        if(size == unknown)
+        {
+            rows.clear();
+        }
+        for(std::size_t i = 0; i < names.size(); ++i)
+        {
+            if(!seen[i] && required(i))
+            {
+                return reader.fail_missing_field(names[i]);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Build the rows of a {"key":[value,...],...} json object
+     * @throws nlohmann::json::out_of_range if a column is missing, nlohmann::json::type_error if the columns differ in length
+     */
+    template<typename Vector, template<typename> typename Registry>
+    auto from_columns(nlohmann::json const& node) -> Vector {
+        using T = typename Vector::value_type;
+        constexpr auto const& names = dori::meta::field_names<T, Registry>;
+
+        Vector rows;
+        if constexpr(names.size() != 0)
+        {
+            rows.resize(node.at(std::string(names[0])).size());
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                ([&] {
+                    constexpr auto ptr = dori::meta::field_at<T, Registry, I>.ptr();
+                    using field_type = std::remove_cvref_t<decltype(std::declval<T const&>().*ptr)>;
+                    auto const& column = node.at(std::string(names[I]));
+                    if(!column.is_array() || column.size() != rows.size())
+                    {
+                        throw nlohmann::json::type_error::create(302, "column '" + std::string(names[I]) + "' does not hold "
+                                                                      + std::to_string(rows.size()) + " values", &column);
+                    }
+                    for(std::size_t i = 0; i < rows.size(); ++i)
+                    {
+                        rows[i].*ptr = from_json_value<field_type, Registry>(column[i]);
+                    }
+                }(), ...);
+            }(std::make_index_sequence<names.size()>{});
+        }
+        return rows;
+    }
+
+    /**
+     * @brief Write the key of a map entry as a json string
+     */
+    template<typename Key, typename Writer>
+    auto write_map_key(Writer& writer, Key const& key) -> void {
+        static_assert(dori::meta::json_map_key<Key>, "map key type has no json conversion, please specialize dori::meta::map_key");
+        if constexpr(dori::meta::is_string_v<Key>)
+        {
+            writer.write_string(std::string_view(key.data(), key.size()));
+        }
+        else
+        {
+            writer.write_string(dori::meta::map_key<Key>::format(key));
+        }
+    }
+}
+
+/**
+ * @tparam Instrumentation hooks recording the encodes and decodes of the reflected type, see instrumentation.hpp
+ */
+template<refl::meta::reflector reflector, typename Instrumentation = dori::json::no_instrumentation>
+class json_serializer : public serializer<json_serializer<reflector, Instrumentation>>
 {
 public:
 
@@ -20,12 +408,54 @@ public:
 
     /**
      * @brief Serialize a type T into a string
+     *
+     * The text is byte-identical to serialize_obj<T, Registry>(t).dump(), but written in the dom text format
+     * into a string allocated once, see serialize_exact.
      * @return The serialized string
      */
     template<typename T, template<typename> typename Registry>
     auto serialize(T const& t) const -> std::string requires(std::is_base_of_v<typename reflector::inner_class, T>) {
+        constexpr dori::json::write_options dom{.format = dori::json::text_format::dom};
+        if constexpr(Instrumentation::enabled)
+        {
+            typename Instrumentation::template probe<T, Registry> probe(_reflector.name(), dori::json::operation::encode);
+            auto json = serialize_exact<T, Registry>(t, dom);
+            probe.done(json.size());
+            return json;
+        }
+        else
+        {
+            return serialize_exact<T, Registry>(t, dom);
+        }
+    }
 
-        return serialize_obj<T, Registry>(t).dump();
+    /**
+     * @brief Json text of t written with options into a string allocated once at its exact size, measured
+     * beforehand by the same walk over a size_writer
+     */
+    template<typename T, template<typename> typename Registry>
+    auto serialize_exact(T const& t, dori::json::write_options const options) const -> std::string requires(std::is_base_of_v<typename reflector::inner_class, T>) {
+        dori::json::size_writer measure(options);
+        write_obj<T, Registry>(t, measure);
+        auto const size = measure.size();
+        auto const write = [&](char* const data) {
+            dori::json::unchecked_buffer buffer(data, size);
+            dori::json::writer<dori::json::unchecked_buffer> writer(buffer, options);
+            write_obj<T, Registry>(t, writer);
+            assert(buffer.size() == size && "serialize_exact: written size differs from the predicted size");
+        };
+
+        std::string json;
+#if defined(__cpp_lib_string_resize_and_overwrite)
+        json.resize_and_overwrite(size, [&](char* const data, std::size_t) {
+            write(data);
+            return size;
+        });
+#else
+        json.resize(size);
+        write(json.data());
+#endif
+        return json;
     }
 
     template<typename T, template<typename> typename Registry>
@@ -39,6 +469,35 @@ public:
         }, _reflector);
     }
 
+    /**
+     * @brief Serialize a type T by appending its json text to buffer, without building a nlohmann::json
+     *
+     * With {.format = dori::json::text_format::dom} the appended text is byte-identical to serialize<T, Registry>(t),
+     * the default native format writes floats with their own digits and raw lazy<T> members verbatim.
+     */
+    template<typename T, template<typename> typename Registry, dori::json::output_buffer Buffer>
+    auto serialize_to(T const& t, Buffer& buffer, dori::json::write_options const options = {}) const -> void requires(std::is_base_of_v<typename reflector::inner_class, T>) {
+        dori::json::writer<Buffer> writer(buffer, options);
+        write_obj<T, Registry>(t, writer);
+    }
+
+    template<typename T, template<typename> typename Registry, typename Writer>
+    auto write_obj(T const& t, Writer& writer) const -> void requires(std::is_base_of_v<typename reflector::inner_class, T>) {
+        if constexpr(Instrumentation::enabled && !std::is_same_v<Writer, dori::json::size_writer>)
+        {
+            // the dom text format stands for the DOM encode, which only records its top-level type
+            if(writer.options().format == dori::json::text_format::native)
+            {
+                typename Instrumentation::template probe<T, Registry> probe(_reflector.name(), dori::json::operation::encode);
+                auto const start = writer.size();
+                write_members<T, Registry>(t, writer);
+                probe.done(writer.size() - start);
+                return;
+            }
+        }
+        write_members<T, Registry>(t, writer);
+    }
+
     /**
      * @brief Deserialize a string into type T
      * @return The deserialized string as T
@@ -49,24 +508,210 @@ public:
      */
     template<typename T, template<typename> typename Registry>
     constexpr auto deserialize(std::string const& json_string) const -> T requires(std::is_base_of_v<typename reflector::inner_class, T>) {
-        return deserialize_obj<T, Registry>(nlohmann::json::parse(json_string));
+        if constexpr(Instrumentation::enabled)
+        {
+            typename Instrumentation::template probe<T, Registry> probe(_reflector.name(), dori::json::operation::decode);
+            auto t = deserialize_obj<T, Registry>(nlohmann::json::parse(json_string));
+            probe.done(json_string.size());
+            return t;
+        }
+        else
+        {
+            return deserialize_obj<T, Registry>(nlohmann::json::parse(json_string));
+        }
     }
 
     template<typename T, template<typename> typename Registry>
     constexpr auto deserialize_obj(nlohmann::json const& node) const -> decltype(auto) requires(std::is_base_of_v<typename reflector::inner_class, T> && std::is_default_constructible_v<T>) {
-        return refl::apply([&](auto&& ... args){
-            T t;
-            ((t.*args.ptr() = from_json_value<std::remove_cvref_t<decltype(t.*args.ptr())>, Registry>(node.at(args.name()))), ...);
-            return t;//RVO
-        }, _reflector);
+        constexpr auto const& names = dori::meta::field_names<T, Registry>;
+        constexpr auto const& order = dori::meta::sorted_fields<T, Registry>;
+
+        if(!node.is_object())
+        {
+            throw nlohmann::json::type_error::create(304, "cannot use at() with " + std::string(node.type_name()), &node);
+        }
+
+        T t;
+        std::array<bool, names.size()> seen{};
+        std::size_t next = 0;// nlohmann objects iterate in sorted key order, so expect the next field of that order
+
+        for(auto const& [key, value] : node.items())
+        {
+            auto const index = dori::meta::field_index<T, Registry>::find(key, next < order.size ? order.index[next] : names.size());
+            if(index == dori::meta::field_index<T, Registry>::npos)
+            {
+                continue;
+            }
+            seen[index] = true;
+            dom_field_readers<T, Registry>[index](value, t);
+            ++next;
+        }
+
+        for(std::size_t i = 0; i < names.size(); ++i)
+        {
+            if(!seen[i])
+            {
+                throw nlohmann::json::out_of_range::create(403, "key '" + std::string(names[i]) + "' not found", &node);
+            }
+        }
+        return t;//RVO
+    }
+
+    /**
+     * @brief Deserialize a string into type T, decoding tokens straight into the reflected members without building a nlohmann::json
+     * @param resource if not null, std::pmr members (at any depth) and the parser scratch state allocate from it
+     * @return The deserialized string as T
+     *
+     * @throws nlohmann::json::parse_error if the string is not json
+     * @throws nlohmann::json::out_of_range if the requested reflected data does not exist
+     * @throws nlohmann::json::type_error if the requested reflected data has not the same type
+     */
+    template<typename T, template<typename> typename Registry>
+    auto deserialize_from(std::string_view const json_string, std::pmr::memory_resource* const resource = nullptr) const -> T requires(std::is_base_of_v<typename reflector::inner_class, T> && std::is_default_constructible_v<T>) {
+        T t;
+        deserialize_into<T, Registry>(t, json_string, resource);
+        return t;
+    }
+
+    /**
+     * @brief Deserialize a string into an existing t, overwriting it in place
+     *
+     * Strings and vectors keep their capacity, map entries are updated in place and leftover
+     * elements and entries are removed: decoding into a recycled t of the same shape does not allocate.
+     * If decoding fails, t is left partially overwritten.
+     *
+     * @throws nlohmann::json::parse_error if the string is not json
+     * @throws nlohmann::json::out_of_range if the requested reflected data does not exist
+     * @throws nlohmann::json::type_error if the requested reflected data has not the same type
+     */
+    template<typename T, template<typename> typename Registry>
+    auto deserialize_into(T& t, std::string_view const json_string, std::pmr::memory_resource* const resource = nullptr) const -> void requires(std::is_base_of_v<typename reflector::inner_class, T>) {
+        dori::json::reader reader(json_string, resource);
+        if(!read_obj<T, Registry>(reader, t) || !reader.finish())
+        {
+            dori::json::throw_error(reader);
+        }
+    }
+
+    /**
+     * @brief Read a json object into t, every reflected field must be present and unknown keys are skipped
+     * @return false on failure, the error is recorded in reader
+     */
+    template<typename T, template<typename> typename Registry>
+    auto read_obj(dori::json::reader& reader, T& t) const -> bool requires(std::is_base_of_v<typename reflector::inner_class, T>) {
+        if constexpr(Instrumentation::enabled)
+        {
+            typename Instrumentation::template probe<T, Registry> probe(_reflector.name(), dori::json::operation::decode);
+            auto const start = reader.position();
+            if(!read_members<T, Registry>(reader, t))
+            {
+                return false;
+            }
+            probe.done(reader.position() - start);
+            return true;
+        }
+        else
+        {
+            return read_members<T, Registry>(reader, t);
+        }
+    }
+
+    /**
+     * @brief Read the value of the field of declaration index index into t
+     * @return false on failure, the error is recorded in reader
+     */
+    template<typename T, template<typename> typename Registry>
+    static auto read_field(std::size_t const index, dori::json::reader& reader, T& t) -> bool {
+        return field_readers<T, Registry>[index](reader, t);
     }
 private:
+    template<typename T, template<typename> typename Registry, typename Writer>
+    auto write_members(T const& t, Writer& writer) const -> void {
+        using fragments = dori::json::key_fragments<T, Registry>;
+
+        if constexpr(fragments::size == 0)
+        {
+            writer.write_raw("{}");
+        }
+        else
+        {
+            refl::apply([&] (auto const& ... args) {
+                auto const fields = std::forward_as_tuple(args...);
+
+                [&]<std::size_t... I>(std::index_sequence<I...>) {
+                    ((writer.write_raw(fragments::get(I)), write_field<T, Registry>(t, std::get<dori::meta::sorted_fields<T, Registry>.index[I]>(fields), writer)), ...);
+                }(std::make_index_sequence<fragments::size>{});
+            }, _reflector);
+            writer.put('}');
+        }
+    }
+
+    template<typename T, template<typename> typename Registry>
+    auto read_members(dori::json::reader& reader, T& t) const -> bool {
+        constexpr auto const& names = dori::meta::field_names<T, Registry>;
+        std::array<bool, names.size()> seen{};
+        std::size_t expected = dori::meta::first_field<T, Registry>;
+
+        bool const succeeded = reader.read_object([&](std::string_view const key) {
+            auto const index = dori::meta::field_index<T, Registry>::find(key, expected);
+            if(index == dori::meta::field_index<T, Registry>::npos)
+            {
+                return reader.skip_value();
+            }
+            seen[index] = true;
+            expected = dori::meta::next_field<T, Registry>[index];
+            return field_readers<T, Registry>[index](reader, t) || reader.trace_member(names[index]);
+        });
+
+        if(!succeeded)
+        {
+            return false;
+        }
+        for(std::size_t i = 0; i < names.size(); ++i)
+        {
+            if(!seen[i])
+            {
+                return reader.fail_missing_field(names[i]);
+            }
+        }
+        return true;
+    }
+
+    template<typename T, template<typename> typename Registry, typename Field, typename Writer>
+    static auto write_field(T const& t, Field const& field, Writer& writer) -> void {
+        write_json_value<std::remove_cvref_t<decltype(t.*field.ptr())>, Registry>(writer, t.*field.ptr());
+    }
+
+    /**
+     * @brief One reader per field, indexed by declaration order, so a key resolved by dori::meta::field_index reaches its member in O(1)
+     */
+    template<typename T, template<typename> typename Registry>
+    static constexpr auto field_readers = []<std::size_t... I>(std::index_sequence<I...>) {
+        return std::array<bool (*)(dori::json::reader&, T&), sizeof...(I)>{
+            +[](dori::json::reader& reader, T& t) {
+                constexpr auto ptr = dori::meta::field_at<T, Registry, I>.ptr();
+                return read_json_value<std::remove_cvref_t<decltype(t.*ptr)>, Registry>(reader, t.*ptr);
+            }...
+        };
+    }(std::make_index_sequence<dori::meta::field_count<T, Registry>>{});
+
+    template<typename T, template<typename> typename Registry>
+    static constexpr auto dom_field_readers = []<std::size_t... I>(std::index_sequence<I...>) {
+        return std::array<void (*)(nlohmann::json const&, T&), sizeof...(I)>{
+            +[](nlohmann::json const& node, T& t) {
+                constexpr auto ptr = dori::meta::field_at<T, Registry, I>.ptr();
+                t.*ptr = from_json_value<std::remove_cvref_t<decltype(t.*ptr)>, Registry>(node);
+            }...
+        };
+    }(std::make_index_sequence<dori::meta::field_count<T, Registry>>{});
+
     reflector const& _reflector;
 };
 
 template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
 auto get_serializer() -> decltype(auto) {
-    static constexpr json_serializer serializer = json_serializer(Registry<T>::reflector);
+    using reflector = std::remove_cvref_t<decltype(Registry<T>::reflector)>;
+    static constexpr json_serializer<reflector, dori::meta::instrumentation_t<T, Registry>> serializer(Registry<T>::reflector);
 
     return serializer;
 }
@@ -94,8 +739,15 @@ auto to_json_pair(std::string_view const key, T const& typed_value) -> std::pair
 
 template<typename T, template<typename> typename Registry>
 auto to_json_value(T const& typed_value) -> decltype(auto) {
-    if constexpr (std::is_pointer_v<std::decay_t<T>> == false &&
-                  std::is_standard_layout_v<T> &&
+    if constexpr (dori::meta::is_lazy_v<T>)
+    {
+        if(typed_value.is_raw())
+        {
+            return nlohmann::json::parse(typed_value.raw());
+        }
+        return to_json_pair<typename T::value_type, Registry>({}, typed_value.get()).second;
+    }
+    else if constexpr (std::is_pointer_v<std::decay_t<T>> == false &&
                   refl::registered<T, Registry>)
     {
         auto const& serializer = get_serializer<T, Registry>();
@@ -109,16 +761,30 @@ auto to_json_value(T const& typed_value) -> decltype(auto) {
     {
         return static_cast<std::string const&>(typed_value);
     }
+    else if constexpr (dori::meta::is_string_v<T> || dori::meta::is_borrowed_string_v<T>)
+    {
+        return std::string(typed_value.data(), typed_value.size());
+    }
     else if constexpr (std::ranges::range<T>)//Maybe care with wstring etc... as you want them to be serialized as std::string
     {
         if constexpr(dori::meta::is_map_v<T>)
         {
-            static_assert(std::is_same_v<typename T::key_type, std::string>, "Please, only use std::map with key_type as std::string");
+            using key_type = dori::meta::map_key_t<T>;
+            static_assert(dori::meta::json_map_key<key_type>, "map key type has no json conversion, please specialize dori::meta::map_key");
             nlohmann::json data_array = nlohmann::json::array();
 
             for(auto& value : typed_value)
             {
-                nlohmann::json obj = {to_json_pair<typename T::value_type::second_type, Registry>(value.first, value.second)};
+                nlohmann::json obj;
+                if constexpr(dori::meta::is_string_v<key_type>)
+                {
+                    obj = {to_json_pair<dori::meta::map_mapped_t<T>, Registry>(std::string_view(value.first), value.second)};
+                }
+                else
+                {
+                    auto const key = dori::meta::map_key<key_type>::format(value.first);
+                    obj = {to_json_pair<dori::meta::map_mapped_t<T>, Registry>(std::string_view(key), value.second)};
+                }
 
                 data_array.push_back(obj);
             }
@@ -144,7 +810,6 @@ auto to_json_value(T const& typed_value) -> decltype(auto) {
     else
     {
         static_assert(std::is_pointer_v<std::decay_t<T>> == false &&
-                        std::is_standard_layout_v<T> &&
                         refl::registered<T, Registry> ||
                         std::is_fundamental_v<T> ||
                         std::is_convertible_v<T, std::string const&> ||
@@ -156,24 +821,27 @@ auto to_json_value(T const& typed_value) -> decltype(auto) {
 
 template<typename T, template<typename> typename Registry>
 auto from_json_value(nlohmann::json const& node) -> decltype(auto) {
-    if constexpr(std::is_assignable_v<T, std::string const&>)
+    if constexpr(dori::meta::is_borrowed_string_v<T>)
     {
-        return node.get<std::string>();
+        static_assert(!dori::meta::is_borrowed_string_v<T>, "std::string_view and std::span<char const> members would view the temporary nlohmann::json, decode them with from_json_borrowed");
     }
-    else if constexpr (std::is_floating_point_v<T>)
+    else if constexpr(dori::meta::is_lazy_v<T>)
     {
-        return node.get<double>();
+        return T(from_json_value<typename T::value_type, Registry>(node));// no text to defer to in a DOM
     }
-    else if constexpr (std::is_integral_v<T>)
+    else if constexpr(std::is_assignable_v<T, std::string const&> && !dori::meta::is_optional_v<T>)
     {
-        return node.get<int>();
+        return node.get<std::string>();
     }
     else if constexpr (std::is_same_v<T, bool>)
     {
         return node.get<bool>();
     }
+    else if constexpr (std::is_floating_point_v<T> || std::is_integral_v<T>)
+    {
+        return dori::json::get_number<T>(node);
+    }
     else if constexpr ( std::is_pointer_v<std::decay_t<T>> == false &&
-                        std::is_standard_layout_v<T> &&
                         refl::registered<T, Registry>)
     {
         auto const& serializer = get_serializer<T, Registry>();
@@ -183,7 +851,44 @@ auto from_json_value(nlohmann::json const& node) -> decltype(auto) {
     {
         T tarray;
 
-        if constexpr(std::is_array_v<T> || dori::meta::is_std_array_v<T>)
+        if constexpr(dori::meta::is_map_v<T>)
+        {
+            using mapped_type = dori::meta::map_mapped_t<T>;
+            if constexpr(requires { tarray.reserve(node.size()); })
+            {
+                tarray.reserve(node.size());
+            }
+            auto const add = [&](std::string const& key, nlohmann::json const& v) {
+                if constexpr(dori::meta::is_vector_map_v<T>)
+                {
+                    tarray.emplace_back(dori::json::to_map_key<T>(key), from_json_value<mapped_type, Registry>(v));
+                }
+                else
+                {
+                    tarray.insert_or_assign(dori::json::to_map_key<T>(key), from_json_value<mapped_type, Registry>(v));
+                }
+            };
+            // either [{"key":value},...] pairs or a {"key":value,...} object
+            if(node.is_object())
+            {
+                for(auto const& [key, v] : node.items())
+                {
+                    add(key, v);
+                }
+            }
+            else
+            {
+                for(auto& v : node)
+                {
+                    add(v.begin().key(), v.begin().value());
+                }
+            }
+            if constexpr(dori::meta::is_vector_map_v<T>)
+            {
+                std::ranges::stable_sort(tarray, {}, &T::value_type::first);
+            }
+        }
+        else if constexpr(std::is_array_v<T> || dori::meta::is_std_array_v<T>)
         {
             size_t i = 0;
             for(auto& t : tarray)
@@ -193,21 +898,22 @@ auto from_json_value(nlohmann::json const& node) -> decltype(auto) {
         }
         else if constexpr(dori::meta::is_vector_v<T>)
         {
-            for(auto& v : node)
+            if constexpr(dori::json::is_record_vector_v<T, Registry>)
             {
-                tarray.push_back(from_json_value<typename T::value_type, Registry>(v));
+                if(node.is_object())
+                {
+                    return dori::json::from_columns<T, Registry>(node);
+                }
             }
-        }
-        else if constexpr(dori::meta::is_map_v<T> && std::is_same_v<typename T::key_type, std::string>)
-        {
+            tarray.reserve(node.size());
             for(auto& v : node)
             {
-                tarray[v.begin().key()] = from_json_value<typename T::value_type::second_type, Registry>(v.begin().value());
+                tarray.push_back(from_json_value<typename T::value_type, Registry>(v));
             }
         }
         else
         {
-            static_assert(std::is_array_v<T> || dori::meta::is_std_array_v<T> || dori::meta::is_vector_v<T> || dori::meta::is_map_v<T>  && std::is_same_v<typename T::key_type, std::string>, "array is not supported by the json deserializer, please use std::array, std::vector, std::map with std::string key or plain array");
+            static_assert(std::is_array_v<T> || dori::meta::is_std_array_v<T> || dori::meta::is_vector_v<T> || dori::meta::is_map_v<T>, "array is not supported by the json deserializer, please use std::array, std::vector, a map or plain array");
         }
 
         return tarray;
@@ -235,7 +941,286 @@ auto from_json_value(nlohmann::json const& node) -> decltype(auto) {
     else
     {
         static_assert(std::is_pointer_v<std::decay_t<T>> == false &&
-                              std::is_standard_layout_v<T> &&
+                              refl::registered<T, Registry> ||
+                std::is_assignable_v<T, std::string const&> ||
+                std::is_floating_point_v<T> ||
+                std::is_integral_v<T> ||
+                std::is_same_v<T, bool> ||
+                std::is_assignable_v<T, std::nullptr_t> ||
+                std::is_assignable_v<T, std::nullopt_t> ||
+                std::ranges::range<T>,
+                      "Type cannot be reflected. Please provide a reflector for this class ");
+    }
+}
+
+template<typename T, template<typename> typename Registry, typename Writer>
+auto write_json_value(Writer& writer, T const& typed_value) -> void {
+    if constexpr (dori::meta::is_lazy_v<T>)
+    {
+        if(typed_value.is_raw() && writer.options().format == dori::json::text_format::dom)
+        {
+            writer.write_raw(nlohmann::json::parse(typed_value.raw()).dump());
+        }
+        else if(typed_value.is_raw())
+        {
+            writer.write_raw(typed_value.raw());
+        }
+        else
+        {
+            write_json_value<typename T::value_type, Registry>(writer, typed_value.get());
+        }
+    }
+    else if constexpr (std::is_pointer_v<std::decay_t<T>> == false &&
+                  refl::registered<T, Registry>)
+    {
+        auto const& serializer = get_serializer<T, Registry>();
+        serializer.template write_obj<T, Registry>(typed_value, writer);
+    }
+    else if constexpr (std::is_same_v<T, bool>)
+    {
+        writer.write_bool(typed_value);
+    }
+    else if constexpr (std::is_same_v<T, std::nullptr_t>)
+    {
+        writer.write_null();
+    }
+    else if constexpr (std::is_integral_v<T>)
+    {
+        writer.write_integer(typed_value);
+    }
+    else if constexpr (std::is_same_v<T, float>)
+    {
+        if(writer.options().format == dori::json::text_format::dom)
+        {
+            writer.write_double(static_cast<double>(typed_value));
+        }
+        else
+        {
+            writer.write_float(typed_value);
+        }
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        writer.write_double(static_cast<double>(typed_value));
+    }
+    else if constexpr (std::is_convertible_v<T, std::string const&>)
+    {
+        writer.write_string(static_cast<std::string const&>(typed_value));
+    }
+    else if constexpr (dori::meta::is_string_v<T> || dori::meta::is_borrowed_string_v<T>)
+    {
+        writer.write_string(std::string_view(typed_value.data(), typed_value.size()));
+    }
+    else if constexpr (dori::meta::is_map_v<T>)
+    {
+        bool const as_object = writer.options().maps == dori::json::map_encoding::object;
+        writer.put(as_object ? '{' : '[');
+        bool first = true;
+        for(auto& [key, value] : typed_value)
+        {
+            if(!first)
+            {
+                writer.put(',');
+            }
+            first = false;
+
+            if(!as_object)
+            {
+                writer.put('{');
+            }
+            dori::json::write_map_key(writer, key);
+            writer.put(':');
+            write_json_value<dori::meta::map_mapped_t<T>, Registry>(writer, value);
+            if(!as_object)
+            {
+                writer.put('}');
+            }
+        }
+        writer.put(as_object ? '}' : ']');
+    }
+    else if constexpr (std::ranges::range<T>)
+    {
+        if constexpr(dori::json::is_record_vector_v<T, Registry>)
+        {
+            if(writer.options().arrays == dori::json::array_encoding::columns)
+            {
+                dori::json::write_columns<typename T::value_type, Registry>(writer, typed_value);
+                return;
+            }
+        }
+        writer.put('[');
+        bool first = true;
+        for(auto& value : typed_value)
+        {
+            if(!first)
+            {
+                writer.put(',');
+            }
+            first = false;
+            write_json_value<std::ranges::range_value_t<T>, Registry>(writer, value);
+        }
+        writer.put(']');
+    }
+    else if constexpr (dori::meta::is_optional_v<T>)
+    {
+        if(typed_value.has_value())
+        {
+            write_json_value<typename T::value_type, Registry>(writer, typed_value.value());
+        }
+        else
+        {
+            writer.write_null();
+        }
+    }
+    else
+    {
+        static_assert(std::is_pointer_v<std::decay_t<T>> == false &&
+                        refl::registered<T, Registry> ||
+                        std::is_fundamental_v<T> ||
+                        std::is_convertible_v<T, std::string const&> ||
+                        dori::meta::is_string_v<T> ||
+                        dori::meta::is_borrowed_string_v<T> ||
+                        std::ranges::range<T> ||
+                        dori::meta::is_optional_v<T>,
+                        "Type cannot be reflected and is not a range. Please provide a reflector for this class or a string conversion function.");
+    }
+}
+
+template<typename T, template<typename> typename Registry>
+auto read_json_value(dori::json::reader& reader, T& value) -> bool {
+    if constexpr (dori::meta::uses_memory_resource_v<T>)
+    {
+        // std::pmr members of non allocator-aware owners (structs, std::optional...) were built on the default
+        // resource, and assigning does not propagate the allocator: rebuild them on the reader resource
+        if(reader.resource() != nullptr && value.get_allocator().resource() != reader.resource())
+        {
+            std::destroy_at(&value);
+            std::construct_at(&value, reader.resource());
+        }
+    }
+
+    if constexpr (dori::meta::is_lazy_v<T>)
+    {
+        std::string_view raw;
+        if(!reader.read_raw(raw))
+        {
+            return false;
+        }
+        value = T(raw, &read_json_value<typename T::value_type, Registry>);
+        return true;
+    }
+    else if constexpr (dori::meta::is_optional_v<T>)
+    {
+        if(reader.peek() == 'n')
+        {
+            value.reset();
+            return reader.read_null();
+        }
+        if(!value.has_value())
+        {
+            value.emplace();
+        }
+        return read_json_value<typename T::value_type, Registry>(reader, *value);
+    }
+    else if constexpr (dori::meta::is_string_v<T>)
+    {
+        return reader.read_string(value);
+    }
+    else if constexpr (dori::meta::is_borrowed_string_v<T>)
+    {
+        std::string_view view;
+        if(!reader.read_string_view(view))
+        {
+            return false;
+        }
+        value = T(view.data(), view.size());
+        return true;
+    }
+    else if constexpr (std::is_assignable_v<T&, std::string const&>)
+    {
+        std::string str;
+        if(!reader.read_string(str))
+        {
+            return false;
+        }
+        value = str;
+        return true;
+    }
+    else if constexpr (std::is_same_v<T, bool>)
+    {
+        return reader.read_bool(value);
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        return reader.read_float(value);
+    }
+    else if constexpr (std::is_integral_v<T>)
+    {
+        return reader.read_integer(value);
+    }
+    else if constexpr ( std::is_pointer_v<std::decay_t<T>> == false &&
+                        refl::registered<T, Registry>)
+    {
+        auto const& serializer = get_serializer<T, Registry>();
+        return serializer.template read_obj<T, Registry>(reader, value);
+    }
+    else if constexpr (dori::meta::is_map_v<T>)
+    {
+        return dori::json::read_map(reader, value, [](dori::json::reader& r, dori::meta::map_mapped_t<T>& mapped) {
+            return read_json_value<dori::meta::map_mapped_t<T>, Registry>(r, mapped);
+        });
+    }
+    else if constexpr (std::ranges::range<T>)
+    {
+        if constexpr(std::is_array_v<T> || dori::meta::is_std_array_v<T>)
+        {
+            std::size_t i = 0;
+            bool const succeeded = reader.read_array([&] {
+                if(i == std::size(value))
+                {
+                    return reader.skip_value();
+                }
+                ++i;
+                return read_json_value<std::ranges::range_value_t<T>, Registry>(reader, value[i - 1]) || reader.trace_element(i - 1);
+            });
+            return succeeded && (i == std::size(value) || reader.fail(dori::json::error_kind::type_mismatch));
+        }
+        else if constexpr(dori::meta::is_vector_v<T>)
+        {
+            if constexpr(dori::json::is_record_vector_v<T, Registry>)
+            {
+                if(reader.peek() == '{')
+                {
+                    using row_type = typename T::value_type;
+                    auto const& serializer = get_serializer<row_type, Registry>();
+                    return dori::json::read_columns<row_type, Registry>(reader, value, [&](std::size_t const index, dori::json::reader& r, row_type& row) {
+                        return serializer.template read_field<row_type, Registry>(index, r, row);
+                    }, [](std::size_t) { return true; });
+                }
+            }
+            // overwrite the existing elements so they keep their own capacity, then drop the leftovers
+            std::size_t i = 0;
+            bool const succeeded = reader.read_array([&] {
+                auto& element = i < value.size() ? value[i] : value.emplace_back();
+                ++i;
+                return read_json_value<typename T::value_type, Registry>(reader, element) || reader.trace_element(i - 1);
+            });
+            value.erase(value.begin() + static_cast<std::ptrdiff_t>(std::min(i, value.size())), value.end());
+            return succeeded;
+        }
+        else
+        {
+            static_assert(std::is_array_v<T> || dori::meta::is_std_array_v<T> || dori::meta::is_vector_v<T>, "array is not supported by the json deserializer, please use std::array, std::vector, a map or plain array");
+        }
+    }
+    else if constexpr (std::is_pointer_v<T>)
+    {
+        value = nullptr;
+        return reader.skip_value();
+    }
+    else
+    {
+        static_assert(std::is_pointer_v<std::decay_t<T>> == false &&
                               refl::registered<T, Registry> ||
                 std::is_assignable_v<T, std::string const&> ||
                 std::is_floating_point_v<T> ||
@@ -255,14 +1240,154 @@ auto range_to_vector(const Range& range) {
     return result;
 }
 
+/**
+ * @brief Exact size of the json text write_json<T, Registry>(b, buffer, options) appends, e.g. to write a length
+ * prefix before the body
+ *
+ * Walks the reflectors like the writer does, adding up the constant key sizes, integer digit counts and string
+ * lengths plus escapes, without writing anything.
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto serialized_size(T const& b, dori::json::write_options const options = {}) -> std::size_t {
+    auto& serializer = get_serializer<T, Registry>();
+    dori::json::size_writer writer(options);
+    serializer.template write_obj<T, Registry>(b, writer);
+    return writer.size();
+}
+
+/**
+ * @brief Json text of b, byte-identical to serializing through nlohmann::json, allocated once at its exact size
+ * @throws nlohmann::json::type_error 316 if a string is not valid UTF-8, like nlohmann::json::dump()
+ */
 template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
 auto to_json(T const& b) -> std::string {
     auto& serializer = get_serializer<T, Registry>();
     return serializer.template serialize<T, Registry>(b);
 }
 
+/**
+ * @brief Json text of b written with options, allocated once at its serialized_size then written without capacity checks
+ *
+ * The text is the one write_json<T, Registry>(b, buffer, options) appends.
+ * @param options e.g. {.maps = dori::json::map_encoding::object}, see write_json
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto to_json(T const& b, dori::json::write_options const options) -> std::string {
+    auto& serializer = get_serializer<T, Registry>();
+    return serializer.template serialize_exact<T, Registry>(b, options);
+}
+
 template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
 auto from_json(std::string const& json_string) -> T {
     auto& serializer = get_serializer<T, Registry>();
     return serializer.template deserialize<T, Registry>(json_string);
 }
+
+/**
+ * @brief Append the json text of b to buffer (std::string, std::vector<char>...) without building a nlohmann::json
+ *
+ * With {.format = dori::json::text_format::dom} the appended text is byte-identical to to_json<T, Registry>(b), the
+ * default native format writes floats with their own shortest digits and raw lazy<T> members verbatim.
+ * @param options e.g. {.maps = dori::json::map_encoding::object} to write maps as json objects,
+ * {.arrays = dori::json::array_encoding::columns} to write std::vector of reflected types column by column.
+ * Every decoder reads maps, and std::vector of reflected types, in both encodings.
+ */
+template<typename T, template<typename> typename Registry, dori::json::output_buffer Buffer> requires(refl::registered<T, Registry>)
+auto write_json(T const& b, Buffer& buffer, dori::json::write_options const options = {}) -> void {
+    auto& serializer = get_serializer<T, Registry>();
+    serializer.template serialize_to<T, Registry>(b, buffer, options);
+}
+
+/**
+ * @brief Decode json_string into a T without building a nlohmann::json, same contract as from_json<T, Registry>
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto read_json(std::string_view const json_string) -> T {
+    auto& serializer = get_serializer<T, Registry>();
+    return serializer.template deserialize_from<T, Registry>(json_string);
+}
+
+/**
+ * @brief T views its input through borrowed or lazy members, which would dangle once the temporary json_string is destroyed
+ */
+template<typename T, template<typename> typename Registry, typename String> requires(dori::json::dangling_input<String, T, Registry>)
+auto read_json(String&& json_string) -> T = delete;
+
+/**
+ * @brief Decode json_string into a T, reporting failures as a value instead of an exception
+ *
+ * Nothing is thrown on the failure path: the error carries the kind, byte offset and json pointer of the first
+ * failure, e.g. {error_kind::type_mismatch, 42, "/data/0/1/token"}.
+ * @param resource if not null, std::pmr members (at any depth) and the parser scratch state allocate from it
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry> && std::is_default_constructible_v<T>)
+auto try_from_json(std::string_view const json_string, std::pmr::memory_resource* const resource = nullptr) -> dori::expected<T, dori::json::error> {
+    auto& serializer = get_serializer<T, Registry>();
+    dori::json::reader reader(json_string, resource);
+    dori::expected<T, dori::json::error> result;
+    if(!serializer.template read_obj<T, Registry>(reader, *result) || !reader.finish())
+    {
+        result = dori::unexpected(dori::json::make_error(reader));
+    }
+    return result;
+}
+
+/**
+ * @brief T views its input through borrowed or lazy members, which would dangle once the temporary json_string is destroyed
+ */
+template<typename T, template<typename> typename Registry, typename String> requires(dori::json::dangling_input<String, T, Registry>)
+auto try_from_json(String&& json_string, std::pmr::memory_resource* resource = nullptr) -> dori::expected<T, dori::json::error> = delete;
+
+/**
+ * @brief Decode json_string into an existing t, reusing its strings, vectors and map entries, see json_serializer::deserialize_into
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto read_json_into(std::string_view const json_string, T& t) -> void {
+    auto& serializer = get_serializer<T, Registry>();
+    serializer.template deserialize_into<T, Registry>(t, json_string);
+}
+
+/**
+ * @brief T views its input through borrowed or lazy members, which would dangle once the temporary json_string is destroyed
+ */
+template<typename T, template<typename> typename Registry, typename String> requires(dori::json::dangling_input<String, T, Registry>)
+auto read_json_into(String&& json_string, T& t) -> void = delete;
+
+/**
+ * @brief Decode json_string into a T whose std::pmr::string / std::pmr::vector / std::pmr::map members, at any depth,
+ * allocate from resource, as well as the parser scratch state
+ *
+ * Meant for a per-request std::pmr::monotonic_buffer_resource released in one shot: resource must outlive the result.
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto from_json(std::string_view const json_string, std::pmr::memory_resource* const resource) -> T {
+    auto& serializer = get_serializer<T, Registry>();
+    return serializer.template deserialize_from<T, Registry>(json_string, resource);
+}
+
+/**
+ * @brief T views its input through borrowed or lazy members, which would dangle once the temporary json_string is destroyed
+ */
+template<typename T, template<typename> typename Registry, typename String> requires(dori::json::dangling_input<String, T, Registry>)
+auto from_json(String&& json_string, std::pmr::memory_resource* resource) -> T = delete;
+
+/**
+ * @brief Decode json_string into a T whose std::string_view and std::span<char const> members borrow instead of copying
+ *
+ * Lifetime contract: borrowed members view json_string itself when the json string has no escape, and an unescaped copy
+ * allocated from arena otherwise, so both json_string and arena must outlive the result. Without arena an escaped
+ * borrowed string fails with nlohmann::json::type_error. Owned members (std::string...) are decoded as usual.
+ *
+ * @throws nlohmann::json::parse_error, nlohmann::json::out_of_range, nlohmann::json::type_error like read_json<T, Registry>
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto from_json_borrowed(std::string_view const json_string, std::pmr::memory_resource* const arena = nullptr) -> T {
+    auto& serializer = get_serializer<T, Registry>();
+    return serializer.template deserialize_from<T, Registry>(json_string, arena);
+}
+
+/**
+ * @brief Borrowed members would dangle once the temporary input is destroyed
+ */
+template<typename T, template<typename> typename Registry, typename String> requires(dori::json::dangling_input<String, T, Registry>)
+auto from_json_borrowed(String&& json_string, std::pmr::memory_resource* arena = nullptr) -> T = delete;
@@ -0,0 +1,537 @@
+#pragma once
+#include <cerrno>
+#include <cstddef>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#if __has_include(<unistd.h>)
+#include <unistd.h>
+#define DORI_JSON_HAS_FD 1
+#endif
+
+#include "json_serializer.hpp"
+
+/**
+ * Batch streaming of records, as NDJSON (one json object per line) or as a single json array.
+ *
+ * Writers serialize records one at a time into a bounded buffer flushed to the sink, readers refill a
+ * bounded buffer from the source and decode one record at a time into a recycled T, so memory stays
+ * proportional to the largest record whatever the size of the batch.
+ */
+namespace dori::json
+{
+    enum class stream_format
+    {
+        ndjson,
+        array
+    };
+
+    constexpr std::size_t default_stream_buffer_size = 64 * 1024;
+
+    class ostream_sink
+    {
+    public:
+        explicit ostream_sink(std::ostream& out) :
+            _out(out)
+        {}
+
+        /**
+         * @throws std::ios_base::failure if the stream fails
+         */
+        auto write(std::string_view const data) -> void {
+            if(!_out.write(data.data(), static_cast<std::streamsize>(data.size())))
+            {
+                throw std::ios_base::failure("json stream: write to std::ostream failed");
+            }
+        }
+
+    private:
+        std::ostream& _out;
+    };
+
+    class istream_source
+    {
+    public:
+        explicit istream_source(std::istream& in) :
+            _in(in)
+        {}
+
+        /**
+         * @brief Read up to size bytes into out, returns the number of bytes read, 0 at the end of the stream
+         * @throws std::ios_base::failure if the stream fails for another reason than its end
+         */
+        auto read(char* const out, std::size_t const size) -> std::size_t {
+            _in.read(out, static_cast<std::streamsize>(size));
+            if(_in.bad())
+            {
+                throw std::ios_base::failure("json stream: read from std::istream failed");
+            }
+            return static_cast<std::size_t>(_in.gcount());
+        }
+
+    private:
+        std::istream& _in;
+    };
+
+#if defined(DORI_JSON_HAS_FD)
+    /**
+     * @brief Sink writing to a file descriptor it does not own
+     */
+    class fd_sink
+    {
+    public:
+        explicit fd_sink(int const fd) :
+            _fd(fd)
+        {}
+
+        /**
+         * @throws std::system_error if write(2) fails
+         */
+        auto write(std::string_view data) -> void {
+            while(!data.empty())
+            {
+                auto const written = ::write(_fd, data.data(), data.size());
+                if(written < 0)
+                {
+                    if(errno == EINTR)
+                    {
+                        continue;
+                    }
+                    throw std::system_error(errno, std::generic_category(), "json stream: write to fd failed");
+                }
+                data.remove_prefix(static_cast<std::size_t>(written));
+            }
+        }
+
+    private:
+        int _fd;
+    };
+
+    /**
+     * @brief Source reading from a file descriptor it does not own
+     */
+    class fd_source
+    {
+    public:
+        explicit fd_source(int const fd) :
+            _fd(fd)
+        {}
+
+        /**
+         * @throws std::system_error if read(2) fails
+         */
+        auto read(char* const out, std::size_t const size) -> std::size_t {
+            while(true)
+            {
+                auto const count = ::read(_fd, out, size);
+                if(count >= 0)
+                {
+                    return static_cast<std::size_t>(count);
+                }
+                if(errno != EINTR)
+                {
+                    throw std::system_error(errno, std::generic_category(), "json stream: read from fd failed");
+                }
+            }
+        }
+
+    private:
+        int _fd;
+    };
+#endif
+
+    /**
+     * @brief Write records of type T one at a time to Sink, buffering at most about buffer_size bytes plus one record
+     *
+     * finish() closes the batch (the closing ']' of the array format) and flushes; the destructor calls it
+     * if needed but drops its errors, call it explicitly to get them.
+     * Lazy members are copied verbatim: in NDJSON, their original text must not span several lines.
+     */
+    template<typename T, template<typename> typename Registry, typename Sink>
+    class record_writer
+    {
+    public:
+        explicit record_writer(Sink sink, stream_format const format = stream_format::ndjson, std::size_t const buffer_size = default_stream_buffer_size) :
+            _sink(std::move(sink)),
+            _format(format),
+            _buffer_size(buffer_size)
+        {
+            _buffer.reserve(buffer_size);
+        }
+
+        record_writer(record_writer const&) = delete;
+        auto operator=(record_writer const&) -> record_writer& = delete;
+
+        ~record_writer() {
+            if(!_finished)
+            {
+                try
+                {
+                    finish();
+                }
+                catch(...)
+                {
+                }
+            }
+        }
+
+        auto write(T const& record) -> void {
+            if(_format == stream_format::array)
+            {
+                _buffer.push_back(_count == 0 ? '[' : ',');
+            }
+            write_json<T, Registry>(record, _buffer);
+            if(_format == stream_format::ndjson)
+            {
+                _buffer.push_back('\n');
+            }
+            ++_count;
+
+            if(_buffer.size() >= _buffer_size)
+            {
+                flush();
+            }
+        }
+
+        /**
+         * @brief Close the batch and flush, later calls do nothing
+         */
+        auto finish() -> void {
+            if(_finished)
+            {
+                return;
+            }
+            _finished = true;
+            if(_format == stream_format::array)
+            {
+                _buffer.append(_count == 0 ? "[]" : "]");
+            }
+            flush();
+        }
+
+        auto count() const -> std::size_t {
+            return _count;
+        }
+
+    private:
+        auto flush() -> void {
+            _sink.write(_buffer);
+            _buffer.clear();
+        }
+
+        Sink _sink;
+        stream_format _format;
+        std::size_t _buffer_size;
+        std::string _buffer;
+        std::size_t _count = 0;
+        bool _finished = false;
+    };
+
+    /**
+     * @brief Read records of type T one at a time from Source, holding at most one record plus chunk_size bytes
+     *
+     * Records are decoded into a recycled T, so a steady stream of records of the same shape does not allocate.
+     * Errors are reported with the nlohmann::json exceptions of read_json, the byte offset of a decoding
+     * error is relative to its record.
+     * T must own its members: records are decoded from an internal buffer overwritten by the next refill,
+     * so std::string_view, std::span<char const> and lazy<T> members would dangle once the reader advances.
+     */
+    template<typename T, template<typename> typename Registry, typename Source>
+    class record_reader
+    {
+        static_assert(!borrows_input_v<T, Registry>, "records are decoded from a buffer reused by the next record, T must not hold std::string_view, std::span<char const> or lazy members");
+
+    public:
+        explicit record_reader(Source source, stream_format const format = stream_format::ndjson, std::size_t const chunk_size = default_stream_buffer_size) :
+            _source(std::move(source)),
+            _format(format),
+            _chunk_size(chunk_size == 0 ? 1 : chunk_size)
+        {}
+
+        /**
+         * @brief Decode the next record into record
+         * @return false once the batch is exhausted
+         */
+        auto next(T& record) -> bool {
+            std::string_view text;
+            if(!(_format == stream_format::ndjson ? next_line(text) : next_element(text)))
+            {
+                return false;
+            }
+            auto& serializer = get_serializer<T, Registry>();
+            serializer.template deserialize_into<T, Registry>(record, text);
+            return true;
+        }
+
+        class iterator
+        {
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+
+            iterator() = default;
+
+            explicit iterator(record_reader& reader) :
+                _reader(&reader)
+            {
+                ++*this;
+            }
+
+            auto operator*() const -> T const& {
+                return _reader->_current;
+            }
+
+            auto operator->() const -> T const* {
+                return &_reader->_current;
+            }
+
+            auto operator++() -> iterator& {
+                if(!_reader->next(_reader->_current))
+                {
+                    _reader = nullptr;
+                }
+                return *this;
+            }
+
+            auto operator++(int) -> void {
+                ++*this;
+            }
+
+            friend auto operator==(iterator const& it, std::default_sentinel_t) -> bool {
+                return it._reader == nullptr;
+            }
+
+        private:
+            record_reader* _reader = nullptr;
+        };
+
+        /**
+         * @brief Single pass: the iterator decodes the next record on increment, and the referenced record is overwritten
+         */
+        auto begin() -> iterator {
+            return iterator(*this);
+        }
+
+        auto end() const -> std::default_sentinel_t {
+            return std::default_sentinel;
+        }
+
+    private:
+        enum class array_state
+        {
+            before_open,
+            rest,
+            done
+        };
+
+        [[noreturn]] auto fail(char const* const message) const -> void {
+            throw nlohmann::json::parse_error::create(101, _consumed + _start + 1, std::string("syntax error: ") + message, nullptr);
+        }
+
+        /**
+         * @brief Append the next chunk of the source after the unconsumed bytes, false at the end of the source
+         */
+        auto refill() -> bool {
+            if(_eof)
+            {
+                return false;
+            }
+            if(_start != 0)
+            {
+                _buffer.erase(0, _start);
+                _consumed += _start;
+                _start = 0;
+            }
+            auto const size = _buffer.size();
+            _buffer.resize(size + _chunk_size);
+            auto const count = _source.read(_buffer.data() + size, _chunk_size);
+            _buffer.resize(size + count);
+            _eof = count == 0;
+            return !_eof;
+        }
+
+        static auto is_blank(std::string_view const text) -> bool {
+            return text.find_first_not_of(" \t\r\n") == std::string_view::npos;
+        }
+
+        auto next_line(std::string_view& line) -> bool {
+            std::size_t scanned = 0;// bytes after _start known to hold no '\n'
+            while(true)
+            {
+                auto const newline = _buffer.find('\n', _start + scanned);
+                if(newline == std::string::npos)
+                {
+                    scanned = _buffer.size() - _start;
+                    if(refill())
+                    {
+                        continue;
+                    }
+                    // last line without a trailing '\n'
+                    line = std::string_view(_buffer).substr(_start);
+                    _start = _buffer.size();
+                    return !is_blank(line);
+                }
+
+                line = std::string_view(_buffer).substr(_start, newline - _start);
+                _start = newline + 1;
+                if(!is_blank(line))
+                {
+                    return true;
+                }
+                scanned = 0;
+            }
+        }
+
+        /**
+         * @brief Next non whitespace character, refilling as needed, '\0' at the end of the source
+         */
+        auto peek() -> char {
+            while(true)
+            {
+                while(_start < _buffer.size() && kernels::scalar::is_whitespace(_buffer[_start]))
+                {
+                    ++_start;
+                }
+                if(_start < _buffer.size())
+                {
+                    return _buffer[_start];
+                }
+                if(!refill())
+                {
+                    return '\0';
+                }
+            }
+        }
+
+        auto next_element(std::string_view& element) -> bool {
+            switch(_array_state)
+            {
+                case array_state::before_open:
+                    if(peek() != '[')
+                    {
+                        fail("expected '[' to open the record array");
+                    }
+                    ++_start;
+                    if(peek() == ']')
+                    {
+                        return close();
+                    }
+                    break;
+                case array_state::rest:
+                    switch(peek())
+                    {
+                        case ']':
+                            return close();
+                        case ',':
+                            ++_start;
+                            break;
+                        default:
+                            fail("expected ',' or ']' after a record");
+                    }
+                    break;
+                case array_state::done:
+                    return false;
+            }
+
+            if(peek() == '\0')
+            {
+                fail("unexpected end of the record array");
+            }
+            auto const length = scan_value();
+            element = std::string_view(_buffer).substr(_start, length);
+            _start += length;
+            _array_state = array_state::rest;
+            return true;
+        }
+
+        auto close() -> bool {
+            ++_start;
+            _array_state = array_state::done;
+            if(peek() != '\0')
+            {
+                fail("unexpected content after the record array");
+            }
+            return false;
+        }
+
+        /**
+         * @brief Length of the value starting at _start, refilling until a value_scanner finds its end
+         */
+        auto scan_value() -> std::size_t {
+            value_scanner scanner;
+            while(true)
+            {
+                auto const length = scanner.scan(std::string_view(_buffer).substr(_start));
+                if(length != value_scanner::npos)
+                {
+                    return length;
+                }
+                if(!refill())
+                {
+                    fail("unexpected end of the record array");
+                }
+            }
+        }
+
+        Source _source;
+        stream_format _format;
+        std::size_t _chunk_size;
+        std::string _buffer;
+        std::size_t _start = 0;
+        std::size_t _consumed = 0;
+        bool _eof = false;
+        array_state _array_state = array_state::before_open;
+        T _current{};
+    };
+}
+
+/**
+ * @brief Write every record of records to out, as NDJSON or as a json array, through a bounded buffer
+ */
+template<typename T, template<typename> typename Registry, std::ranges::input_range Range> requires(refl::registered<T, Registry>)
+auto write_json_records(Range&& records, std::ostream& out, dori::json::stream_format const format = dori::json::stream_format::ndjson) -> void {
+    dori::json::record_writer<T, Registry, dori::json::ostream_sink> writer(dori::json::ostream_sink(out), format);
+    for(auto const& record : records)
+    {
+        writer.write(record);
+    }
+    writer.finish();
+}
+
+/**
+ * @brief Records of in, decoded one at a time, e.g. for(auto const& record : read_json_records<T, Registry>(in))
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto read_json_records(std::istream& in, dori::json::stream_format const format = dori::json::stream_format::ndjson) -> dori::json::record_reader<T, Registry, dori::json::istream_source> {
+    return dori::json::record_reader<T, Registry, dori::json::istream_source>(dori::json::istream_source(in), format);
+}
+
+#if defined(DORI_JSON_HAS_FD)
+/**
+ * @brief Write every record of records to the file descriptor fd, as NDJSON or as a json array, through a bounded buffer
+ */
+template<typename T, template<typename> typename Registry, std::ranges::input_range Range> requires(refl::registered<T, Registry>)
+auto write_json_records(Range&& records, int const fd, dori::json::stream_format const format = dori::json::stream_format::ndjson) -> void {
+    dori::json::record_writer<T, Registry, dori::json::fd_sink> writer(dori::json::fd_sink(fd), format);
+    for(auto const& record : records)
+    {
+        writer.write(record);
+    }
+    writer.finish();
+}
+
+/**
+ * @brief Records read from the file descriptor fd, decoded one at a time
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto read_json_records(int const fd, dori::json::stream_format const format = dori::json::stream_format::ndjson) -> dori::json::record_reader<T, Registry, dori::json::fd_source> {
+    return dori::json::record_reader<T, Registry, dori::json::fd_source>(dori::json::fd_source(fd), format);
+}
+#endif
@@ -0,0 +1,469 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <charconv>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <nlohmann/json.hpp>
+
+#include "json_number.hpp"
+#include "string_kernels.hpp"
+
+namespace dori::json
+{
+    /**
+     * @brief Size of str once escaped the way writer::write_escaped does it
+     */
+    constexpr auto escaped_size(std::string_view const str) -> std::size_t {
+        std::size_t size = 0;
+        for(char const c : str)
+        {
+            auto const u = static_cast<unsigned char>(c);
+            if(u >= 0x20 && u != '"' && u != '\\')
+            {
+                size += 1;
+            }
+            else if(u == '"' || u == '\\' || u == '\b' || u == '\t' || u == '\n' || u == '\f' || u == '\r')
+            {
+                size += 2;
+            }
+            else
+            {
+                size += 6;
+            }
+        }
+        return size;
+    }
+
+    /**
+     * @brief Escape str into out (which must hold escaped_size(str) characters), returns the end of the written characters
+     */
+    constexpr auto escape_into(char* out, std::string_view const str) -> char* {
+        constexpr char hex[] = "0123456789abcdef";
+        for(char const c : str)
+        {
+            auto const u = static_cast<unsigned char>(c);
+            if(u >= 0x20 && u != '"' && u != '\\')
+            {
+                *out++ = c;
+                continue;
+            }
+            *out++ = '\\';
+            switch(u)
+            {
+                case '"':  *out++ = '"'; break;
+                case '\\': *out++ = '\\'; break;
+                case '\b': *out++ = 'b'; break;
+                case '\t': *out++ = 't'; break;
+                case '\n': *out++ = 'n'; break;
+                case '\f': *out++ = 'f'; break;
+                case '\r': *out++ = 'r'; break;
+                default:
+                    *out++ = 'u';
+                    *out++ = '0';
+                    *out++ = '0';
+                    *out++ = hex[u >> 4];
+                    *out++ = hex[u & 0xF];
+                    break;
+            }
+        }
+        return out;
+    }
+
+    /**
+     * @brief Throw the nlohmann::json::type_error 316 that dump() raises if str is not valid UTF-8, with the same message
+     */
+    inline auto check_utf8(std::string_view const str) -> void {
+        constexpr char hex[] = "0123456789ABCDEF";
+        auto const fail = [&](std::string message, unsigned char const byte) {
+            message += "0x";
+            message += hex[byte >> 4];
+            message += hex[byte & 0xF];
+            throw nlohmann::json::type_error::create(316, message, nullptr);
+        };
+
+        std::size_t i = 0;
+        while(i < str.size())
+        {
+            auto const lead = static_cast<unsigned char>(str[i]);
+            if(lead < 0x80)
+            {
+                ++i;
+                continue;
+            }
+
+            // the bounds of the second byte exclude overlong forms, surrogates and code points above U+10FFFF
+            std::size_t length = 2;
+            unsigned char low = 0x80;
+            unsigned char high = 0xBF;
+            if(lead >= 0xE0 && lead <= 0xEF)
+            {
+                length = 3;
+                low = lead == 0xE0 ? 0xA0 : 0x80;
+                high = lead == 0xED ? 0x9F : 0xBF;
+            }
+            else if(lead >= 0xF0 && lead <= 0xF4)
+            {
+                length = 4;
+                low = lead == 0xF0 ? 0x90 : 0x80;
+                high = lead == 0xF4 ? 0x8F : 0xBF;
+            }
+            else if(lead < 0xC2 || lead > 0xDF)
+            {
+                fail("invalid UTF-8 byte at index " + std::to_string(i) + ": ", lead);
+            }
+
+            for(std::size_t k = 1; k < length; ++k)
+            {
+                if(i + k == str.size())
+                {
+                    fail("incomplete UTF-8 string; last byte: ", static_cast<unsigned char>(str.back()));
+                }
+                auto const c = static_cast<unsigned char>(str[i + k]);
+                if(c < (k == 1 ? low : 0x80) || c > (k == 1 ? high : 0xBF))
+                {
+                    fail("invalid UTF-8 byte at index " + std::to_string(i + k) + ": ", c);
+                }
+            }
+            i += length;
+        }
+    }
+
+    /**
+     * @brief A growable character buffer the writer can append to (std::string, std::vector<char>...)
+     */
+    template<typename Buffer>
+    concept output_buffer = requires(Buffer& buffer, char const* data, char c) {
+        buffer.push_back(c);
+        buffer.insert(buffer.end(), data, data);
+    };
+
+    /**
+     * @brief Writes into storage sized up front, e.g. from serialized_size, without capacity checks
+     *
+     * The caller guarantees the storage holds every character written, debug builds assert it.
+     */
+    class unchecked_buffer
+    {
+    public:
+
+        unchecked_buffer(char* const data, std::size_t const capacity) : _begin(data), _end(data), _capacity(capacity) {}
+
+        auto push_back(char const c) -> void {
+            assert(size() < _capacity && "unchecked_buffer: written past the predicted size");
+            *_end++ = c;
+        }
+
+        auto append(char const* const data, std::size_t const size) -> void {
+            assert(size <= _capacity - this->size() && "unchecked_buffer: written past the predicted size");
+            _end = std::copy_n(data, size, _end);
+        }
+
+        auto end() -> char* {
+            return _end;
+        }
+
+        auto insert(char* const position, char const* const first, char const* const last) -> char* {
+            append(first, static_cast<std::size_t>(last - first));
+            return position;
+        }
+
+        auto size() const -> std::size_t {
+            return static_cast<std::size_t>(_end - _begin);
+        }
+
+    private:
+        char* const _begin;
+        char* _end;
+        std::size_t const _capacity;
+    };
+
+    /**
+     * @brief How maps (std::map, std::unordered_map...) are written
+     */
+    enum class map_encoding
+    {
+        pairs,  ///< [{"key":value},...], the encoding of nlohmann::json based to_json
+        object  ///< {"key":value,...}, more compact
+    };
+
+    /**
+     * @brief How std::vector of reflected types are written
+     */
+    enum class array_encoding
+    {
+        rows,   ///< [{"key":value,...},...], one object per element
+        columns ///< {"key":[value,...],...}, one array per member, keys written once
+    };
+
+    /**
+     * @brief How values with more than one valid spelling are written
+     */
+    enum class text_format
+    {
+        native, ///< floats with their own shortest digits, raw lazy<T> members copied verbatim
+        dom     ///< floats through their double widening, raw lazy<T> members normalized and strings checked to be UTF-8, as nlohmann::json::dump() does
+    };
+
+    struct write_options
+    {
+        map_encoding maps = map_encoding::pairs;
+        array_encoding arrays = array_encoding::rows;
+        text_format format = text_format::native;
+    };
+
+    /**
+     * @brief Emits JSON tokens straight into a caller supplied buffer
+     *
+     * With {.format = text_format::dom} the output is byte-identical to nlohmann::json::dump() without indentation,
+     * the default native format only differs in the digits of floats and the text of raw lazy<T> members, and
+     * writes strings that are not valid UTF-8 as they are where the dom format throws like dump().
+     */
+    template<output_buffer Buffer>
+    class writer
+    {
+    public:
+
+        explicit writer(Buffer& buffer, write_options const options = {}) : _buffer(buffer), _options(options) {}
+
+        auto options() const -> write_options const& {
+            return _options;
+        }
+
+        /**
+         * @brief Characters in the buffer, 0 if the buffer cannot tell
+         */
+        auto size() const -> std::size_t {
+            if constexpr(requires { _buffer.size(); })
+            {
+                return _buffer.size();
+            }
+            else
+            {
+                return 0;
+            }
+        }
+
+        auto put(char const c) -> void {
+            _buffer.push_back(c);
+        }
+
+        auto write_raw(std::string_view const str) -> void {
+            if constexpr(requires { _buffer.append(str.data(), str.size()); })
+            {
+                _buffer.append(str.data(), str.size());
+            }
+            else
+            {
+                _buffer.insert(_buffer.end(), str.data(), str.data() + str.size());
+            }
+        }
+
+        auto write_null() -> void {
+            write_raw("null");
+        }
+
+        auto write_bool(bool const value) -> void {
+            write_raw(value ? "true" : "false");
+        }
+
+        template<std::integral I>
+        auto write_integer(I const value) -> void {
+            std::array<char, 24> buffer;
+            auto const result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+            write_raw(std::string_view(buffer.data(), result.ptr - buffer.data()));
+        }
+
+        /**
+         * @brief Write a double with nlohmann's own Grisu2 routine so the digits match dump() exactly
+         *
+         * Non finite values are written as null.
+         */
+        auto write_double(double const value) -> void {
+            if(!std::isfinite(value))
+            {
+                write_null();
+                return;
+            }
+
+            std::array<char, 64> buffer;
+            char const* const end = nlohmann::detail::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+            write_raw(std::string_view(buffer.data(), end - buffer.data()));
+        }
+
+        /**
+         * @brief Write a float with its own shortest round-trip digits, instead of the digits of its double widening
+         *
+         * Non finite values are written as null.
+         */
+        auto write_float(float const value) -> void {
+            if(!std::isfinite(value))
+            {
+                write_null();
+                return;
+            }
+
+            std::array<char, 64> buffer;
+            write_raw(std::string_view(buffer.data(), format_float(buffer.data(), value) - buffer.data()));
+        }
+
+        /**
+         * @brief Write a quoted string, escaping '"', '\\' and control characters
+         */
+        auto write_string(std::string_view const str) -> void {
+            put('"');
+            write_escaped(str);
+            put('"');
+        }
+
+        /**
+         * @throws nlohmann::json::type_error 316 in the dom text format if str is not valid UTF-8
+         */
+        auto write_escaped(std::string_view const str) -> void {
+            if(_options.format == text_format::dom)
+            {
+                check_utf8(str);
+            }
+            char const* run = str.data();
+            char const* const end = str.data() + str.size();
+
+            while(true)
+            {
+                char const* const it = kernels::find_escape(run, end);
+                write_raw(std::string_view(run, it - run));
+                if(it == end)
+                {
+                    return;
+                }
+                write_escape(static_cast<unsigned char>(*it));
+                run = it + 1;
+            }
+        }
+
+    private:
+
+        auto write_escape(unsigned char const c) -> void {
+            char const raw = static_cast<char>(c);
+            std::array<char, 6> escaped;
+            write_raw(std::string_view(escaped.data(), escape_into(escaped.data(), std::string_view(&raw, 1)) - escaped.data()));
+        }
+
+        Buffer& _buffer;
+        write_options _options;
+    };
+
+    /**
+     * @brief Digits of value, and its sign
+     */
+    template<std::integral I>
+    constexpr auto integer_size(I const value) -> std::size_t {
+        using unsigned_type = std::make_unsigned_t<I>;
+        std::size_t size = 1;
+        auto u = static_cast<unsigned_type>(value);
+        if constexpr(std::is_signed_v<I>)
+        {
+            if(value < 0)
+            {
+                ++size;
+                u = static_cast<unsigned_type>(unsigned_type(0) - u);
+            }
+        }
+        for(; u >= 10; u /= 10)
+        {
+            ++size;
+        }
+        return size;
+    }
+
+    /**
+     * @brief Same interface as writer, but only adds up the size of the text writer would emit
+     *
+     * Keys and literals count their constant size, integers their digits and strings their length plus the
+     * extra characters of their escapes. Floating point numbers are formatted on the stack to count them.
+     */
+    class size_writer
+    {
+    public:
+
+        explicit size_writer(write_options const options = {}) : _options(options) {}
+
+        auto options() const -> write_options const& {
+            return _options;
+        }
+
+        auto size() const -> std::size_t {
+            return _size;
+        }
+
+        auto put(char) -> void {
+            ++_size;
+        }
+
+        auto write_raw(std::string_view const str) -> void {
+            _size += str.size();
+        }
+
+        auto write_null() -> void {
+            _size += 4;
+        }
+
+        auto write_bool(bool const value) -> void {
+            _size += value ? 4 : 5;
+        }
+
+        template<std::integral I>
+        auto write_integer(I const value) -> void {
+            _size += integer_size(value);
+        }
+
+        auto write_double(double const value) -> void {
+            if(!std::isfinite(value))
+            {
+                write_null();
+                return;
+            }
+            std::array<char, 64> digits;
+            _size += static_cast<std::size_t>(nlohmann::detail::to_chars(digits.data(), digits.data() + digits.size(), value) - digits.data());
+        }
+
+        auto write_float(float const value) -> void {
+            if(!std::isfinite(value))
+            {
+                write_null();
+                return;
+            }
+            std::array<char, 64> digits;
+            _size += static_cast<std::size_t>(format_float(digits.data(), value) - digits.data());
+        }
+
+        auto write_string(std::string_view const str) -> void {
+            _size += 2;
+            write_escaped(str);
+        }
+
+        auto write_escaped(std::string_view const str) -> void {
+            if(_options.format == text_format::dom)
+            {
+                check_utf8(str);
+            }
+            _size += str.size();
+            char const* it = str.data();
+            char const* const end = str.data() + str.size();
+            while((it = kernels::find_escape(it, end)) != end)
+            {
+                _size += escaped_size(std::string_view(it, 1)) - 1;
+                ++it;
+            }
+        }
+
+    private:
+        write_options _options;
+        std::size_t _size = 0;
+    };
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "json_reader.hpp"
+
+namespace dori::json
+{
+    /**
+     * @brief Member wrapper deferring the decoding of a sub-document until its first access
+     *
+     * When decoded by read_json / from_json_borrowed, a lazy<T> only records the text of its value
+     * (see reader::read_raw). The first get() decodes it into T and caches the result. As long as it is
+     * not accessed mutably, write_json copies the original text through verbatim, while to_json (the dom text
+     * format) normalizes it as nlohmann::json::dump() would.
+     *
+     * Lifetime contract: the recorded text views the decoded input, which must outlive the lazy<T>
+     * until it is decoded. A lazy<T> is not thread safe, not even for concurrent const accesses.
+     */
+    template<typename T>
+    class lazy
+    {
+    public:
+        using value_type = T;
+        using decoder = bool (*)(reader&, T&);
+
+        lazy() = default;
+
+        lazy(T value) :
+            _value(std::move(value))
+        {}
+
+        /**
+         * @param raw the json text of the value
+         * @param decode how to read raw into a T
+         */
+        lazy(std::string_view const raw, decoder const decode) :
+            _raw(raw),
+            _decode(decode)
+        {}
+
+        /**
+         * @brief Whether the value is only held as its original json text, which the native text format copies verbatim
+         */
+        auto is_raw() const -> bool {
+            return _decode != nullptr && !_modified;
+        }
+
+        auto is_decoded() const -> bool {
+            return _value.has_value();
+        }
+
+        auto raw() const -> std::string_view {
+            return _raw;
+        }
+
+        /**
+         * @throws nlohmann::json::parse_error, nlohmann::json::out_of_range, nlohmann::json::type_error if the recorded text
+         * cannot be decoded into T
+         */
+        auto get() const -> T const& {
+            decode();
+            return *_value;
+        }
+
+        /**
+         * @brief Mutable access, the value is serialized from T from then on
+         */
+        auto get() -> T& {
+            decode();
+            _modified = true;
+            return *_value;
+        }
+
+        auto operator*() const -> T const& {
+            return get();
+        }
+
+        auto operator*() -> T& {
+            return get();
+        }
+
+        auto operator->() const -> T const* {
+            return &get();
+        }
+
+        auto operator->() -> T* {
+            return &get();
+        }
+
+    private:
+        auto decode() const -> void {
+            if(_value.has_value())
+            {
+                return;
+            }
+            if(_decode == nullptr)
+            {
+                _value.emplace();
+                return;
+            }
+
+            reader r(_raw);
+            T value{};
+            if(!_decode(r, value) || !r.finish())
+            {
+                throw_error(r);
+            }
+            _value = std::move(value);
+        }
+
+        std::string_view _raw;
+        decoder _decode = nullptr;
+        mutable std::optional<T> _value;
+        bool _modified = false;
+    };
+}
+
+namespace dori::meta
+{
+    template<typename T>
+    struct is_lazy
+    {
+        static constexpr bool value = false;
+    };
+
+    template<typename T>
+    struct is_lazy<dori::json::lazy<T>>
+    {
+        static constexpr bool value = true;
+    };
+
+    template<typename T>
+    constexpr bool is_lazy_v = is_lazy<T>::value;
+}
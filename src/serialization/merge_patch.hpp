@@ -0,0 +1,250 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+#include "json_serializer.hpp"
+
+/**
+ * JSON Merge Patch (RFC 7386) of registered types.
+ *
+ * A patch holds the members that differ between two instances, with nested reflected objects patched
+ * member by member and every other value (arrays, maps encoded as arrays, scalars) replaced whole.
+ * An std::optional member that became empty is patched to null: apply_merge_patch resets it, whereas a
+ * generic RFC 7386 implementation removes the member from the document.
+ */
+namespace dori::json
+{
+    /**
+     * @brief Whether T is an std::optional of a reflected type, patched member by member when present on both sides
+     */
+    template<typename T, template<typename> typename Registry>
+    constexpr bool is_optional_object_v = [] {
+        if constexpr(dori::meta::is_optional_v<T>)
+        {
+            return refl::registered<typename T::value_type, Registry>;
+        }
+        else
+        {
+            return false;
+        }
+    }();
+
+    /**
+     * @brief Deep equality through the reflectors, for members whose types have no operator==
+     */
+    template<typename T, template<typename> typename Registry>
+    auto values_equal(T const& a, T const& b) -> bool {
+        if constexpr(std::is_pointer_v<std::decay_t<T>> == false && refl::registered<T, Registry>)
+        {
+            return refl::apply([&](auto const& ... fields) {
+                return (values_equal<std::remove_cvref_t<decltype(a.*fields.ptr())>, Registry>(a.*fields.ptr(), b.*fields.ptr()) && ...);
+            }, Registry<T>::reflector);
+        }
+        else if constexpr(dori::meta::is_lazy_v<T>)
+        {
+            return values_equal<typename T::value_type, Registry>(a.get(), b.get());
+        }
+        else if constexpr(dori::meta::is_optional_v<T>)
+        {
+            return a.has_value() == b.has_value() && (!a.has_value() || values_equal<typename T::value_type, Registry>(*a, *b));
+        }
+        else if constexpr(dori::meta::is_map_v<T> && !dori::meta::is_ordered_map_v<T>)
+        {
+            return a.size() == b.size() && std::ranges::all_of(a, [&](auto const& x) {
+                auto const y = b.find(x.first);
+                return y != b.end() && values_equal<dori::meta::map_mapped_t<T>, Registry>(x.second, y->second);
+            });
+        }
+        else if constexpr(dori::meta::is_map_v<T>)
+        {
+            return std::ranges::equal(a, b, [](auto const& x, auto const& y) {
+                return x.first == y.first && values_equal<dori::meta::map_mapped_t<T>, Registry>(x.second, y.second);
+            });
+        }
+        else if constexpr(std::ranges::range<T>)
+        {
+            return std::ranges::equal(a, b, [](auto const& x, auto const& y) {
+                return values_equal<std::ranges::range_value_t<T>, Registry>(x, y);
+            });
+        }
+        else
+        {
+            return a == b;
+        }
+    }
+
+    template<typename T, template<typename> typename Registry, typename Writer>
+    auto write_patch(Writer& writer, T const& before, T const& after) -> void;
+
+    /**
+     * @brief Write the patch turning the value before into after, which differ
+     */
+    template<typename T, template<typename> typename Registry, typename Writer>
+    auto write_patch_value(Writer& writer, T const& before, T const& after) -> void {
+        if constexpr(std::is_pointer_v<std::decay_t<T>> == false && refl::registered<T, Registry>)
+        {
+            write_patch<T, Registry>(writer, before, after);
+        }
+        else if constexpr(is_optional_object_v<T, Registry>)
+        {
+            if(!after.has_value())
+            {
+                writer.write_null();
+            }
+            else if(before.has_value())
+            {
+                write_patch<typename T::value_type, Registry>(writer, *before, *after);
+            }
+            else
+            {
+                write_json_value<typename T::value_type, Registry>(writer, *after);
+            }
+        }
+        else
+        {
+            write_json_value<T, Registry>(writer, after);
+        }
+    }
+
+    /**
+     * @brief Write the merge patch object turning before into after, "{}" when they are equal
+     *
+     * Members are walked with refl::apply in the key order of serialize_obj.
+     */
+    template<typename T, template<typename> typename Registry, typename Writer>
+    auto write_patch(Writer& writer, T const& before, T const& after) -> void {
+        writer.put('{');
+        bool first = true;
+        refl::apply([&](auto const& ... args) {
+            auto const fields = std::forward_as_tuple(args...);
+
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                ([&](auto const& field) {
+                    auto const& from = before.*field.ptr();
+                    auto const& to = after.*field.ptr();
+                    using field_type = std::remove_cvref_t<decltype(from)>;
+                    if(values_equal<field_type, Registry>(from, to))
+                    {
+                        return;
+                    }
+                    if(!first)
+                    {
+                        writer.put(',');
+                    }
+                    first = false;
+                    writer.write_string(field.name());
+                    writer.put(':');
+                    write_patch_value<field_type, Registry>(writer, from, to);
+                }(std::get<dori::meta::sorted_fields<T, Registry>.index[I]>(fields)), ...);
+            }(std::make_index_sequence<dori::meta::sorted_fields<T, Registry>.size>{});
+        }, Registry<T>::reflector);
+        writer.put('}');
+    }
+
+    template<typename T, template<typename> typename Registry>
+    auto read_patch(reader& reader, T& t) -> bool;
+
+    /**
+     * @brief One patch applier per field: reflected objects, present or not, are merged, other values replaced
+     */
+    template<typename T, template<typename> typename Registry>
+    constexpr auto patch_appliers = []<std::size_t... I>(std::index_sequence<I...>) {
+        return std::array<bool (*)(reader&, T&), sizeof...(I)>{
+            +[](reader& r, T& t) {
+                constexpr auto ptr = dori::meta::field_at<T, Registry, I>.ptr();
+                using field_type = std::remove_cvref_t<decltype(t.*ptr)>;
+                auto& value = t.*ptr;
+
+                if constexpr(std::is_pointer_v<field_type> == false && refl::registered<field_type, Registry>)
+                {
+                    return read_patch<field_type, Registry>(r, value);
+                }
+                else if constexpr(is_optional_object_v<field_type, Registry>)
+                {
+                    if(r.peek() == 'n')
+                    {
+                        value.reset();
+                        return r.read_null();
+                    }
+                    if(!value.has_value())
+                    {
+                        value.emplace();
+                    }
+                    return read_patch<typename field_type::value_type, Registry>(r, *value);
+                }
+                else
+                {
+                    return read_json_value<field_type, Registry>(r, value);
+                }
+            }...
+        };
+    }(std::make_index_sequence<dori::meta::field_count<T, Registry>>{});
+
+    /**
+     * @brief Merge the patch object under the reader into t, members absent from the patch are left untouched
+     * @return false on failure, the error is recorded in reader
+     */
+    template<typename T, template<typename> typename Registry>
+    auto read_patch(reader& reader, T& t) -> bool {
+        constexpr auto const& names = dori::meta::field_names<T, Registry>;
+        std::size_t expected = dori::meta::first_field<T, Registry>;
+        return reader.read_object([&](std::string_view const key) {
+            auto const index = dori::meta::field_index<T, Registry>::find(key, expected);
+            if(index == dori::meta::field_index<T, Registry>::npos)
+            {
+                return reader.skip_value();
+            }
+            expected = dori::meta::next_field<T, Registry>[index];
+            return patch_appliers<T, Registry>[index](reader, t) || reader.trace_member(names[index]);
+        });
+    }
+}
+
+/**
+ * @brief Append to buffer the RFC 7386 merge patch turning before into after, "{}" when they are equal
+ */
+template<typename T, template<typename> typename Registry, dori::json::output_buffer Buffer> requires(refl::registered<T, Registry>)
+auto write_merge_patch(T const& before, T const& after, Buffer& buffer) -> void {
+    dori::json::writer<Buffer> writer(buffer);
+    dori::json::write_patch<T, Registry>(writer, before, after);
+}
+
+/**
+ * @brief The RFC 7386 merge patch turning before into after, holding only the members that changed
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto to_merge_patch(T const& before, T const& after) -> std::string {
+    std::string patch;
+    write_merge_patch<T, Registry>(before, after, patch);
+    return patch;
+}
+
+/**
+ * @brief Apply an RFC 7386 merge patch onto target in place
+ *
+ * Members absent from the patch keep their value, null empties std::optional members, reflected objects
+ * are merged member by member and other values are replaced. Unknown keys are ignored. If applying
+ * fails, target is left partially patched.
+ *
+ * @throws nlohmann::json::parse_error, nlohmann::json::out_of_range, nlohmann::json::type_error like read_json<T, Registry>
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto apply_merge_patch(T& target, std::string_view const patch) -> void {
+    dori::json::reader reader(patch);
+    if(!dori::json::read_patch<T, Registry>(reader, target) || !reader.finish())
+    {
+        dori::json::throw_error(reader);
+    }
+}
+
+/**
+ * @brief T views its input through borrowed or lazy members, which would dangle once the temporary patch is destroyed
+ */
+template<typename T, template<typename> typename Registry, typename String> requires(dori::json::dangling_input<String, T, Registry>)
+auto apply_merge_patch(T& target, String&& patch) -> void = delete;
@@ -0,0 +1,492 @@
+#pragma once
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <nlohmann/json.hpp>
+
+namespace dori::msgpack
+{
+    enum class error_kind
+    {
+        none,
+        unexpected_end,
+        invalid_byte,
+        number_out_of_range,
+        missing_field,
+        type_mismatch
+    };
+
+    /**
+     * @brief Pull reader over MessagePack bytes, decoding values in place
+     *
+     * Like dori::json::reader it never throws: every read returns false on failure and records the first
+     * error (its kind and byte offset), callers just propagate the false upward.
+     */
+    class reader
+    {
+    public:
+
+        explicit reader(std::span<std::uint8_t const> const input) :
+            _begin(input.data()),
+            _current(input.data()),
+            _end(input.data() + input.size())
+        {}
+
+        auto position() const -> std::size_t {
+            return static_cast<std::size_t>(_current - _begin);
+        }
+
+        auto error() const -> error_kind {
+            return _error;
+        }
+
+        auto error_offset() const -> std::size_t {
+            return _error_offset;
+        }
+
+        /**
+         * @brief Name of the missing field when error() is error_kind::missing_field
+         */
+        auto error_field() const -> std::string_view {
+            return _error_field;
+        }
+
+        /**
+         * @brief Record the first error and return false so it can be propagated with a single return
+         */
+        auto fail(error_kind const kind) -> bool {
+            if(_error == error_kind::none)
+            {
+                _error = kind;
+                _error_offset = position();
+            }
+            return false;
+        }
+
+        auto fail_missing_field(std::string_view const name) -> bool {
+            if(_error == error_kind::none)
+            {
+                _error_field = name;
+            }
+            return fail(error_kind::missing_field);
+        }
+
+        /**
+         * @brief Bytes left in the input, an upper bound of the elements a header can announce
+         */
+        auto remaining() const -> std::size_t {
+            return static_cast<std::size_t>(_end - _current);
+        }
+
+        auto at_end() const -> bool {
+            return _current == _end;
+        }
+
+        /**
+         * @brief Succeeds if the whole input has been read
+         */
+        auto finish() -> bool {
+            return at_end() || fail(error_kind::invalid_byte);
+        }
+
+        auto is_nil() const -> bool {
+            return !at_end() && *_current == 0xc0;
+        }
+
+        auto read_nil() -> bool {
+            if(!is_nil())
+            {
+                return fail_type();
+            }
+            ++_current;
+            return true;
+        }
+
+        auto read_bool(bool& value) -> bool {
+            if(at_end() || (*_current != 0xc2 && *_current != 0xc3))
+            {
+                return fail_type();
+            }
+            value = *_current++ == 0xc3;
+            return true;
+        }
+
+        /**
+         * @brief Read any integer encoding into exactly I, failing with number_out_of_range if I cannot hold it
+         */
+        template<std::integral I> requires(!std::is_same_v<I, bool>)
+        auto read_integer(I& value) -> bool {
+            auto const start = _current;
+            std::uint64_t magnitude = 0;
+            bool negative = false;
+            if(!read_integer_bits(magnitude, negative))
+            {
+                return false;
+            }
+
+            if(negative)
+            {
+                auto const v = static_cast<std::int64_t>(magnitude);
+                if constexpr(std::is_signed_v<I>)
+                {
+                    if(v >= std::numeric_limits<I>::min())
+                    {
+                        value = static_cast<I>(v);
+                        return true;
+                    }
+                }
+            }
+            else if(magnitude <= static_cast<std::uint64_t>(std::numeric_limits<I>::max()))
+            {
+                value = static_cast<I>(magnitude);
+                return true;
+            }
+            _current = start;
+            return fail(error_kind::number_out_of_range);
+        }
+
+        /**
+         * @brief Read a float, double or integer encoding into F
+         */
+        template<std::floating_point F>
+        auto read_float(F& value) -> bool {
+            if(at_end())
+            {
+                return fail(error_kind::unexpected_end);
+            }
+            switch(*_current)
+            {
+                case 0xca:
+                {
+                    std::uint32_t bits = 0;
+                    if(!read_big_endian(bits))
+                    {
+                        return false;
+                    }
+                    value = static_cast<F>(std::bit_cast<float>(bits));
+                    return true;
+                }
+                case 0xcb:
+                {
+                    std::uint64_t bits = 0;
+                    if(!read_big_endian(bits))
+                    {
+                        return false;
+                    }
+                    value = static_cast<F>(std::bit_cast<double>(bits));
+                    return true;
+                }
+                default:
+                {
+                    std::uint64_t magnitude = 0;
+                    bool negative = false;
+                    if(!read_integer_bits(magnitude, negative))
+                    {
+                        return false;
+                    }
+                    value = negative ? static_cast<F>(static_cast<std::int64_t>(magnitude)) : static_cast<F>(magnitude);
+                    return true;
+                }
+            }
+        }
+
+        /**
+         * @brief Read a string as a view of the input, MessagePack strings are never escaped
+         */
+        auto read_string_view(std::string_view& value) -> bool {
+            std::size_t size = 0;
+            if(!read_header(size, 0xa0, 0xe0, 0xd9, 0xda, 0xdb))
+            {
+                return false;
+            }
+            if(static_cast<std::size_t>(_end - _current) < size)
+            {
+                return fail(error_kind::unexpected_end);
+            }
+            value = std::string_view(reinterpret_cast<char const*>(_current), size);
+            _current += size;
+            return true;
+        }
+
+        template<typename Traits, typename Alloc>
+        auto read_string(std::basic_string<char, Traits, Alloc>& value) -> bool {
+            std::string_view view;
+            if(!read_string_view(view))
+            {
+                return false;
+            }
+            value.assign(view.data(), view.size());
+            return true;
+        }
+
+        /**
+         * @brief Read an array header, its size elements come next
+         */
+        auto read_array_header(std::size_t& size) -> bool {
+            return read_header(size, 0x90, 0xf0, 0, 0xdc, 0xdd);
+        }
+
+        /**
+         * @brief Read a map header, its size keys and values come next in turn
+         */
+        auto read_map_header(std::size_t& size) -> bool {
+            return read_header(size, 0x80, 0xf0, 0, 0xde, 0xdf);
+        }
+
+        /**
+         * @brief Skip any MessagePack value, nested arrays and maps included
+         */
+        auto skip_value() -> bool {
+            std::size_t pending = 1;
+            while(pending != 0)
+            {
+                --pending;
+                if(at_end())
+                {
+                    return fail(error_kind::unexpected_end);
+                }
+                std::uint8_t const marker = *_current;
+                std::size_t size = 0;
+                if(marker <= 0x7f || marker >= 0xe0 || marker == 0xc0 || marker == 0xc2 || marker == 0xc3)
+                {
+                    ++_current;
+                }
+                else if((marker & 0xf0) == 0x80 || marker == 0xde || marker == 0xdf)
+                {
+                    if(!read_map_header(size))
+                    {
+                        return false;
+                    }
+                    pending += 2 * size;
+                }
+                else if((marker & 0xf0) == 0x90 || marker == 0xdc || marker == 0xdd)
+                {
+                    if(!read_array_header(size))
+                    {
+                        return false;
+                    }
+                    pending += size;
+                }
+                else if(!skip_bytes(marker))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        /**
+         * @brief Fail with type_mismatch on a valid marker of another type, with a syntax error otherwise
+         */
+        auto fail_type() -> bool {
+            if(at_end())
+            {
+                return fail(error_kind::unexpected_end);
+            }
+            return fail(*_current == 0xc1 ? error_kind::invalid_byte : error_kind::type_mismatch);
+        }
+
+        /**
+         * @brief Read the big endian value following the marker under the cursor
+         */
+        template<typename UInt>
+        auto read_big_endian(UInt& value) -> bool {
+            if(static_cast<std::size_t>(_end - _current) < sizeof(UInt) + 1)
+            {
+                return fail(error_kind::unexpected_end);
+            }
+            value = 0;
+            for(std::size_t i = 1; i <= sizeof(UInt); ++i)
+            {
+                value = static_cast<UInt>((value << 8) | _current[i]);
+            }
+            _current += sizeof(UInt) + 1;
+            return true;
+        }
+
+        template<typename Int>
+        auto read_signed(std::uint64_t& magnitude, bool& negative) -> bool {
+            std::make_unsigned_t<Int> bits = 0;
+            if(!read_big_endian(bits))
+            {
+                return false;
+            }
+            auto const v = static_cast<std::int64_t>(static_cast<Int>(bits));
+            negative = v < 0;
+            magnitude = static_cast<std::uint64_t>(v);
+            return true;
+        }
+
+        template<typename UInt>
+        auto read_unsigned(std::uint64_t& magnitude) -> bool {
+            UInt bits = 0;
+            if(!read_big_endian(bits))
+            {
+                return false;
+            }
+            magnitude = bits;
+            return true;
+        }
+
+        /**
+         * @brief Read any integer encoding, as its two's complement bits when negative
+         */
+        auto read_integer_bits(std::uint64_t& magnitude, bool& negative) -> bool {
+            if(at_end())
+            {
+                return fail(error_kind::unexpected_end);
+            }
+            std::uint8_t const marker = *_current;
+            negative = false;
+            if(marker <= 0x7f)
+            {
+                magnitude = marker;
+                ++_current;
+                return true;
+            }
+            if(marker >= 0xe0)
+            {
+                negative = true;
+                magnitude = static_cast<std::uint64_t>(static_cast<std::int64_t>(static_cast<std::int8_t>(marker)));
+                ++_current;
+                return true;
+            }
+            switch(marker)
+            {
+                case 0xcc: return read_unsigned<std::uint8_t>(magnitude);
+                case 0xcd: return read_unsigned<std::uint16_t>(magnitude);
+                case 0xce: return read_unsigned<std::uint32_t>(magnitude);
+                case 0xcf: return read_unsigned<std::uint64_t>(magnitude);
+                case 0xd0: return read_signed<std::int8_t>(magnitude, negative);
+                case 0xd1: return read_signed<std::int16_t>(magnitude, negative);
+                case 0xd2: return read_signed<std::int32_t>(magnitude, negative);
+                case 0xd3: return read_signed<std::int64_t>(magnitude, negative);
+                default: return fail_type();
+            }
+        }
+
+        /**
+         * @param fix marker of the fix format, whose size is in the bits outside fix_mask
+         * @param marker8 marker of the 8 bit size format, 0 if the type has none
+         */
+        auto read_header(std::size_t& size, std::uint8_t const fix, std::uint8_t const fix_mask,
+                         std::uint8_t const marker8, std::uint8_t const marker16, std::uint8_t const marker32) -> bool {
+            if(at_end())
+            {
+                return fail(error_kind::unexpected_end);
+            }
+            std::uint8_t const marker = *_current;
+            if((marker & fix_mask) == fix)
+            {
+                size = marker & static_cast<std::uint8_t>(~fix_mask);
+                ++_current;
+                return true;
+            }
+
+            std::uint64_t length = 0;
+            bool succeeded = false;
+            if(marker8 != 0 && marker == marker8)
+            {
+                succeeded = read_unsigned<std::uint8_t>(length);
+            }
+            else if(marker == marker16)
+            {
+                succeeded = read_unsigned<std::uint16_t>(length);
+            }
+            else if(marker == marker32)
+            {
+                succeeded = read_unsigned<std::uint32_t>(length);
+            }
+            else
+            {
+                return fail_type();
+            }
+            size = static_cast<std::size_t>(length);
+            return succeeded;
+        }
+
+        /**
+         * @brief Skip a scalar, string, bin or ext value of the given marker
+         */
+        auto skip_bytes(std::uint8_t const marker) -> bool {
+            std::uint64_t length = 0;
+            bool succeeded = true;
+            if((marker & 0xe0) == 0xa0)
+            {
+                length = marker & 0x1f;
+                ++_current;
+            }
+            else
+            {
+                switch(marker)
+                {
+                    case 0xcc: case 0xd0: length = 1; ++_current; break;
+                    case 0xcd: case 0xd1: length = 2; ++_current; break;
+                    case 0xca: case 0xce: case 0xd2: length = 4; ++_current; break;
+                    case 0xcb: case 0xcf: case 0xd3: length = 8; ++_current; break;
+                    case 0xd4: length = 2; ++_current; break;
+                    case 0xd5: length = 3; ++_current; break;
+                    case 0xd6: length = 5; ++_current; break;
+                    case 0xd7: length = 9; ++_current; break;
+                    case 0xd8: length = 17; ++_current; break;
+                    case 0xc4: case 0xd9: succeeded = read_unsigned<std::uint8_t>(length); break;
+                    case 0xc5: case 0xda: succeeded = read_unsigned<std::uint16_t>(length); break;
+                    case 0xc6: case 0xdb: succeeded = read_unsigned<std::uint32_t>(length); break;
+                    case 0xc7: succeeded = read_unsigned<std::uint8_t>(length); ++length; break;
+                    case 0xc8: succeeded = read_unsigned<std::uint16_t>(length); ++length; break;
+                    case 0xc9: succeeded = read_unsigned<std::uint32_t>(length); ++length; break;
+                    default: return fail(error_kind::invalid_byte);
+                }
+            }
+            if(!succeeded)
+            {
+                return false;
+            }
+            if(static_cast<std::uint64_t>(_end - _current) < length)
+            {
+                return fail(error_kind::unexpected_end);
+            }
+            _current += length;
+            return true;
+        }
+
+        std::uint8_t const* _begin;
+        std::uint8_t const* _current;
+        std::uint8_t const* _end;
+        error_kind _error = error_kind::none;
+        std::size_t _error_offset = 0;
+        std::string_view _error_field;
+    };
+
+    /**
+     * @brief Throw the nlohmann::json exception matching the reader error, as nlohmann::json::from_msgpack would
+     *
+     * @throws nlohmann::json::parse_error on malformed MessagePack
+     * @throws nlohmann::json::out_of_range if a reflected field is missing or a number does not fit its member
+     * @throws nlohmann::json::type_error if a value has not the reflected type
+     */
+    [[noreturn]] inline auto throw_error(reader const& r) -> void {
+        auto const byte = r.error_offset() + 1;
+        switch(r.error())
+        {
+            case error_kind::missing_field:
+                throw nlohmann::json::out_of_range::create(403, "key '" + std::string(r.error_field()) + "' not found", nullptr);
+            case error_kind::type_mismatch:
+                throw nlohmann::json::type_error::create(302, "unexpected value type at byte " + std::to_string(byte), nullptr);
+            case error_kind::number_out_of_range:
+                throw nlohmann::json::out_of_range::create(406, "number overflow at byte " + std::to_string(byte), nullptr);
+            case error_kind::unexpected_end:
+                throw nlohmann::json::parse_error::create(110, byte, "syntax error while parsing MessagePack value: unexpected end of input", nullptr);
+            default:
+                throw nlohmann::json::parse_error::create(112, byte, "syntax error while parsing MessagePack value: invalid byte", nullptr);
+        }
+    }
+}
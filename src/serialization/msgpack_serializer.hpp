@@ -0,0 +1,545 @@
+#pragma once
+#include "serializer.hpp"
+#include "traits.hpp"
+#include "field_table.hpp"
+#include "lazy.hpp"
+#include "msgpack_writer.hpp"
+#include "msgpack_reader.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <refl/refl.hpp>
+#include <refl/registry.hpp>
+
+template<typename T, template<typename> typename Registry, typename Writer>
+auto write_msgpack_value(Writer& writer, T const& typed_value) -> void;
+
+template<typename T, template<typename> typename Registry>
+auto read_msgpack_value(dori::msgpack::reader& reader, T& value) -> bool;
+
+/**
+ * @brief MessagePack counterpart of json_serializer, driven by the same registry and reflectors
+ *
+ * Reflected objects are maps keyed by field name, in declaration order. Map members are native
+ * MessagePack maps (not the [{key: value}...] arrays of the default json encoding), std::vector and arrays are
+ * arrays, std::optional is nil when empty. Decoding follows the json rules: unknown keys are skipped and
+ * every reflected field must be present.
+ */
+template<refl::meta::reflector reflector>
+class msgpack_serializer : public serializer<msgpack_serializer<reflector>>
+{
+public:
+
+    constexpr msgpack_serializer(reflector const& refl) : _reflector(refl) {}
+
+    /**
+     * @brief Serialize a type T into MessagePack bytes
+     */
+    template<typename T, template<typename> typename Registry>
+    auto serialize(T const& t) const -> std::vector<std::uint8_t> requires(std::is_base_of_v<typename reflector::inner_class, T>) {
+        std::vector<std::uint8_t> bytes;
+        serialize_to<T, Registry>(t, bytes);
+        return bytes;
+    }
+
+    /**
+     * @brief Serialize a type T by appending its MessagePack bytes to buffer
+     */
+    template<typename T, template<typename> typename Registry, dori::json::output_buffer Buffer>
+    auto serialize_to(T const& t, Buffer& buffer) const -> void requires(std::is_base_of_v<typename reflector::inner_class, T>) {
+        dori::msgpack::writer<Buffer> writer(buffer);
+        write_obj<T, Registry>(t, writer);
+    }
+
+    template<typename T, template<typename> typename Registry, typename Writer>
+    auto write_obj(T const& t, Writer& writer) const -> void requires(std::is_base_of_v<typename reflector::inner_class, T>) {
+        refl::apply([&] (auto const& ... args) {
+            writer.write_map_header(sizeof...(args));
+            ((writer.write_string(args.name()), write_msgpack_value<std::remove_cvref_t<decltype(t.*args.ptr())>, Registry>(writer, t.*args.ptr())), ...);
+        }, _reflector);
+    }
+
+    /**
+     * @brief Deserialize MessagePack bytes into type T
+     *
+     * @throws nlohmann::json::parse_error if the bytes are not MessagePack
+     * @throws nlohmann::json::out_of_range if the requested reflected data does not exist
+     * @throws nlohmann::json::type_error if the requested reflected data has not the same type
+     */
+    template<typename T, template<typename> typename Registry>
+    auto deserialize(std::span<std::uint8_t const> const bytes) const -> T requires(std::is_base_of_v<typename reflector::inner_class, T> && std::is_default_constructible_v<T>) {
+        T t;
+        deserialize_into<T, Registry>(t, bytes);
+        return t;
+    }
+
+    /**
+     * @brief Deserialize MessagePack bytes into an existing t, overwriting it in place like json_serializer::deserialize_into
+     */
+    template<typename T, template<typename> typename Registry>
+    auto deserialize_into(T& t, std::span<std::uint8_t const> const bytes) const -> void requires(std::is_base_of_v<typename reflector::inner_class, T>) {
+        dori::msgpack::reader reader(bytes);
+        if(!read_obj<T, Registry>(reader, t) || !reader.finish())
+        {
+            dori::msgpack::throw_error(reader);
+        }
+    }
+
+    /**
+     * @brief Read a MessagePack map into t, every reflected field must be present and unknown keys are skipped
+     * @return false on failure, the error is recorded in reader
+     */
+    template<typename T, template<typename> typename Registry>
+    auto read_obj(dori::msgpack::reader& reader, T& t) const -> bool requires(std::is_base_of_v<typename reflector::inner_class, T>) {
+        constexpr auto const& names = dori::meta::field_names<T, Registry>;
+        std::array<bool, names.size()> seen{};
+        std::size_t expected = 0;
+
+        std::size_t size = 0;
+        if(!reader.read_map_header(size))
+        {
+            return false;
+        }
+        for(std::size_t i = 0; i < size; ++i)
+        {
+            std::string_view key;
+            if(!reader.read_string_view(key))
+            {
+                return false;
+            }
+            auto const index = dori::meta::field_index<T, Registry>::find(key, expected);
+            if(index == dori::meta::field_index<T, Registry>::npos)
+            {
+                if(!reader.skip_value())
+                {
+                    return false;
+                }
+                continue;
+            }
+            seen[index] = true;
+            expected = index + 1;
+            if(!field_readers<T, Registry>[index](reader, t))
+            {
+                return false;
+            }
+        }
+
+        for(std::size_t i = 0; i < names.size(); ++i)
+        {
+            if(!seen[i])
+            {
+                return reader.fail_missing_field(names[i]);
+            }
+        }
+        return true;
+    }
+private:
+    /**
+     * @brief One reader per field, indexed by declaration order, see json_serializer::field_readers
+     */
+    template<typename T, template<typename> typename Registry>
+    static constexpr auto field_readers = []<std::size_t... I>(std::index_sequence<I...>) {
+        return std::array<bool (*)(dori::msgpack::reader&, T&), sizeof...(I)>{
+            +[](dori::msgpack::reader& reader, T& t) {
+                constexpr auto ptr = dori::meta::field_at<T, Registry, I>.ptr();
+                return read_msgpack_value<std::remove_cvref_t<decltype(t.*ptr)>, Registry>(reader, t.*ptr);
+            }...
+        };
+    }(std::make_index_sequence<dori::meta::field_count<T, Registry>>{});
+
+    reflector const& _reflector;
+};
+
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto get_msgpack_serializer() -> decltype(auto) {
+    static constexpr msgpack_serializer serializer = msgpack_serializer(Registry<T>::reflector);
+
+    return serializer;
+}
+
+template<typename T, template<typename> typename Registry, typename Writer>
+auto write_msgpack_value(Writer& writer, T const& typed_value) -> void {
+    if constexpr (std::is_pointer_v<std::decay_t<T>> == false &&
+                  refl::registered<T, Registry>)
+    {
+        auto const& serializer = get_msgpack_serializer<T, Registry>();
+        serializer.template write_obj<T, Registry>(typed_value, writer);
+    }
+    else if constexpr (std::is_same_v<T, bool>)
+    {
+        writer.write_bool(typed_value);
+    }
+    else if constexpr (std::is_same_v<T, std::nullptr_t>)
+    {
+        writer.write_nil();
+    }
+    else if constexpr (std::is_integral_v<T>)
+    {
+        writer.write_integer(typed_value);
+    }
+    else if constexpr (std::is_same_v<T, float>)
+    {
+        writer.write_float(typed_value);
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        writer.write_double(static_cast<double>(typed_value));
+    }
+    else if constexpr (dori::meta::is_string_v<T> || dori::meta::is_borrowed_string_v<T>)
+    {
+        writer.write_string(std::string_view(typed_value.data(), typed_value.size()));
+    }
+    else if constexpr (std::is_convertible_v<T, std::string const&>)
+    {
+        writer.write_string(static_cast<std::string const&>(typed_value));
+    }
+    else if constexpr (dori::meta::is_map_v<T>)
+    {
+        using key_type = dori::meta::map_key_t<T>;
+        static_assert(dori::meta::json_map_key<key_type>, "map key type has no conversion, please specialize dori::meta::map_key");
+        writer.write_map_header(std::ranges::size(typed_value));
+        for(auto const& [key, value] : typed_value)
+        {
+            if constexpr(dori::meta::is_string_v<key_type>)
+            {
+                writer.write_string(std::string_view(key.data(), key.size()));
+            }
+            else
+            {
+                writer.write_string(dori::meta::map_key<key_type>::format(key));
+            }
+            write_msgpack_value<dori::meta::map_mapped_t<T>, Registry>(writer, value);
+        }
+    }
+    else if constexpr (std::ranges::sized_range<T const>)
+    {
+        writer.write_array_header(std::ranges::size(typed_value));
+        for(auto const& value : typed_value)
+        {
+            write_msgpack_value<std::ranges::range_value_t<T>, Registry>(writer, value);
+        }
+    }
+    else if constexpr (dori::meta::is_optional_v<T>)
+    {
+        if(typed_value.has_value())
+        {
+            write_msgpack_value<typename T::value_type, Registry>(writer, typed_value.value());
+        }
+        else
+        {
+            writer.write_nil();
+        }
+    }
+    else
+    {
+        static_assert(!dori::meta::is_lazy_v<T>, "lazy members hold json text and cannot be encoded as MessagePack");
+        static_assert(std::is_pointer_v<std::decay_t<T>> == false &&
+                        refl::registered<T, Registry> ||
+                        std::is_fundamental_v<T> ||
+                        std::is_convertible_v<T, std::string const&> ||
+                        dori::meta::is_string_v<T> ||
+                        dori::meta::is_borrowed_string_v<T> ||
+                        std::ranges::sized_range<T const> ||
+                        dori::meta::is_optional_v<T>,
+                        "Type cannot be reflected and is not a range. Please provide a reflector for this class or a string conversion function.");
+    }
+}
+
+template<typename T, template<typename> typename Registry>
+auto read_msgpack_value(dori::msgpack::reader& reader, T& value) -> bool {
+    if constexpr (dori::meta::is_optional_v<T>)
+    {
+        if(reader.is_nil())
+        {
+            value.reset();
+            return reader.read_nil();
+        }
+        if(!value.has_value())
+        {
+            value.emplace();
+        }
+        return read_msgpack_value<typename T::value_type, Registry>(reader, *value);
+    }
+    else if constexpr (dori::meta::is_string_v<T>)
+    {
+        return reader.read_string(value);
+    }
+    else if constexpr (dori::meta::is_borrowed_string_v<T>)
+    {
+        std::string_view view;
+        if(!reader.read_string_view(view))
+        {
+            return false;
+        }
+        value = T(view.data(), view.size());
+        return true;
+    }
+    else if constexpr (std::is_assignable_v<T&, std::string const&>)
+    {
+        std::string str;
+        if(!reader.read_string(str))
+        {
+            return false;
+        }
+        value = str;
+        return true;
+    }
+    else if constexpr (std::is_same_v<T, bool>)
+    {
+        return reader.read_bool(value);
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        return reader.read_float(value);
+    }
+    else if constexpr (std::is_integral_v<T>)
+    {
+        return reader.read_integer(value);
+    }
+    else if constexpr ( std::is_pointer_v<std::decay_t<T>> == false &&
+                        refl::registered<T, Registry>)
+    {
+        auto const& serializer = get_msgpack_serializer<T, Registry>();
+        return serializer.template read_obj<T, Registry>(reader, value);
+    }
+    else if constexpr (dori::meta::is_map_v<T>)
+    {
+        using key_type = dori::meta::map_key_t<T>;
+        using mapped_type = dori::meta::map_mapped_t<T>;
+        static_assert(dori::meta::json_map_key<key_type>, "map key type has no conversion, please specialize dori::meta::map_key");
+
+        std::size_t size = 0;
+        if(!reader.read_map_header(size))
+        {
+            return false;
+        }
+        if(size > reader.remaining())
+        {
+            return reader.fail(dori::msgpack::error_kind::unexpected_end);
+        }
+        auto const read_key = [&](key_type& key) {
+            std::string_view text;
+            if(!reader.read_string_view(text))
+            {
+                return false;
+            }
+            if constexpr(dori::meta::is_string_v<key_type>)
+            {
+                key.assign(text.data(), text.size());
+                return true;
+            }
+            else
+            {
+                return dori::meta::map_key<key_type>::parse(text, key) || reader.fail(dori::msgpack::error_kind::type_mismatch);
+            }
+        };
+
+        if constexpr(dori::meta::is_vector_map_v<T>)
+        {
+            // overwrite the existing entries so they keep their own capacity, then restore the key order if needed
+            value.resize(size);
+            for(auto& [key, mapped] : value)
+            {
+                if(!read_key(key) || !read_msgpack_value<mapped_type, Registry>(reader, mapped))
+                {
+                    return false;
+                }
+            }
+            if(!std::ranges::is_sorted(value, {}, &T::value_type::first))
+            {
+                std::ranges::stable_sort(value, {}, &T::value_type::first);
+            }
+            return true;
+        }
+        else if constexpr(dori::meta::is_ordered_map_v<T>)
+        {
+            // merge with a cursor like the json read_map: the writer emits keys in map order, so in steady state
+            // each key is the entry under the cursor and is updated in place. Entries the cursor passes over are stale.
+            // String keys ordered by std::less compare as the bytes themselves, other keys go through key_comp().
+            constexpr bool byte_ordered = dori::meta::is_string_v<key_type> &&
+                                          (std::is_same_v<typename T::key_compare, std::less<key_type>> || std::is_same_v<typename T::key_compare, std::less<>>);
+            auto cursor = value.begin();
+            for(std::size_t i = 0; i < size; ++i)
+            {
+                auto entry = cursor;
+                if constexpr(byte_ordered)
+                {
+                    std::string_view text;
+                    if(!reader.read_string_view(text))
+                    {
+                        return false;
+                    }
+                    while(cursor != value.end() && std::string_view(cursor->first) < text)
+                    {
+                        cursor = value.erase(cursor);
+                    }
+                    entry = cursor;
+                    if(cursor != value.end() && std::string_view(cursor->first) == text)
+                    {
+                        ++cursor;
+                    }
+                    else
+                    {
+                        entry = value.try_emplace(cursor, key_type(text, value.get_allocator()));
+                    }
+                }
+                else
+                {
+                    key_type key{};
+                    if(!read_key(key))
+                    {
+                        return false;
+                    }
+                    auto const less = value.key_comp();
+                    while(cursor != value.end() && less(cursor->first, key))
+                    {
+                        cursor = value.erase(cursor);
+                    }
+                    entry = cursor;
+                    if(cursor != value.end() && !less(key, cursor->first))
+                    {
+                        ++cursor;
+                    }
+                    else
+                    {
+                        entry = value.try_emplace(cursor, std::move(key));
+                    }
+                }
+                if(!read_msgpack_value<mapped_type, Registry>(reader, entry->second))
+                {
+                    return false;
+                }
+            }
+            value.erase(cursor, value.end());
+            return true;
+        }
+        else
+        {
+            // hashed maps are cleared but keep their buckets
+            value.clear();
+            if constexpr(requires { value.reserve(size); })
+            {
+                value.reserve(size);
+            }
+            for(std::size_t i = 0; i < size; ++i)
+            {
+                key_type key{};
+                if(!read_key(key) || !read_msgpack_value<mapped_type, Registry>(reader, value.try_emplace(std::move(key)).first->second))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+    else if constexpr (std::is_array_v<T> || dori::meta::is_std_array_v<T>)
+    {
+        std::size_t size = 0;
+        if(!reader.read_array_header(size))
+        {
+            return false;
+        }
+        if(size != std::size(value))
+        {
+            return reader.fail(dori::msgpack::error_kind::type_mismatch);
+        }
+        for(auto& element : value)
+        {
+            if(!read_msgpack_value<std::ranges::range_value_t<T>, Registry>(reader, element))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    else if constexpr (dori::meta::is_vector_v<T>)
+    {
+        // overwrite the existing elements so they keep their own capacity, then drop the leftovers
+        std::size_t size = 0;
+        if(!reader.read_array_header(size))
+        {
+            return false;
+        }
+        if(size > reader.remaining())
+        {
+            return reader.fail(dori::msgpack::error_kind::unexpected_end);
+        }
+        value.resize(size);
+        for(auto& element : value)
+        {
+            if(!read_msgpack_value<typename T::value_type, Registry>(reader, element))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    else if constexpr (std::is_pointer_v<T>)
+    {
+        value = nullptr;
+        return reader.skip_value();
+    }
+    else
+    {
+        static_assert(!dori::meta::is_lazy_v<T>, "lazy members hold json text and cannot be decoded from MessagePack");
+        static_assert(std::is_pointer_v<std::decay_t<T>> == false &&
+                              refl::registered<T, Registry> ||
+                std::is_assignable_v<T, std::string const&> ||
+                std::is_floating_point_v<T> ||
+                std::is_integral_v<T> ||
+                std::is_same_v<T, bool> ||
+                dori::meta::is_vector_v<T> ||
+                dori::meta::is_map_v<T>,
+                      "Type cannot be reflected. Please provide a reflector for this class ");
+    }
+}
+
+/**
+ * @brief Encode b as MessagePack, with the registry and reflectors used for json
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto to_msgpack(T const& b) -> std::vector<std::uint8_t> {
+    auto& serializer = get_msgpack_serializer<T, Registry>();
+    return serializer.template serialize<T, Registry>(b);
+}
+
+/**
+ * @brief Append the MessagePack bytes of b to buffer (std::vector<std::uint8_t>, std::string...)
+ */
+template<typename T, template<typename> typename Registry, dori::json::output_buffer Buffer> requires(refl::registered<T, Registry>)
+auto write_msgpack(T const& b, Buffer& buffer) -> void {
+    auto& serializer = get_msgpack_serializer<T, Registry>();
+    serializer.template serialize_to<T, Registry>(b, buffer);
+}
+
+/**
+ * @brief Decode MessagePack bytes into a T, std::string_view members view bytes
+ *
+ * @throws nlohmann::json::parse_error, nlohmann::json::out_of_range, nlohmann::json::type_error like from_json<T, Registry>
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto from_msgpack(std::span<std::uint8_t const> const bytes) -> T {
+    auto& serializer = get_msgpack_serializer<T, Registry>();
+    return serializer.template deserialize<T, Registry>(bytes);
+}
+
+/**
+ * @brief Decode MessagePack bytes into an existing t, reusing its strings, vectors and map entries
+ *
+ * Like read_json_into, ordered maps are merged with a cursor so their matching entries are updated in place,
+ * vector_map entries are overwritten in place and hashed maps are cleared but keep their buckets.
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto read_msgpack_into(std::span<std::uint8_t const> const bytes, T& t) -> void {
+    auto& serializer = get_msgpack_serializer<T, Registry>();
+    serializer.template deserialize_into<T, Registry>(t, bytes);
+}
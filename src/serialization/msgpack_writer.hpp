@@ -0,0 +1,165 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+
+#include "json_writer.hpp"
+
+namespace dori::msgpack
+{
+    /**
+     * @brief Emits MessagePack values straight into a caller supplied byte buffer (std::vector<std::uint8_t>, std::string...)
+     *
+     * Integers and lengths use their smallest encoding, like nlohmann::json::to_msgpack.
+     */
+    template<dori::json::output_buffer Buffer>
+    class writer
+    {
+    public:
+
+        explicit writer(Buffer& buffer) : _buffer(buffer) {}
+
+        auto write_nil() -> void {
+            put(0xc0);
+        }
+
+        auto write_bool(bool const value) -> void {
+            put(value ? 0xc3 : 0xc2);
+        }
+
+        template<std::integral I>
+        auto write_integer(I const value) -> void {
+            if constexpr(std::is_signed_v<I>)
+            {
+                if(value < 0)
+                {
+                    auto const v = static_cast<std::int64_t>(value);
+                    if(v >= -32)
+                    {
+                        put(static_cast<std::uint8_t>(v));
+                    }
+                    else if(v >= std::numeric_limits<std::int8_t>::min())
+                    {
+                        put_big_endian(0xd0, static_cast<std::uint8_t>(v));
+                    }
+                    else if(v >= std::numeric_limits<std::int16_t>::min())
+                    {
+                        put_big_endian(0xd1, static_cast<std::uint16_t>(v));
+                    }
+                    else if(v >= std::numeric_limits<std::int32_t>::min())
+                    {
+                        put_big_endian(0xd2, static_cast<std::uint32_t>(v));
+                    }
+                    else
+                    {
+                        put_big_endian(0xd3, static_cast<std::uint64_t>(v));
+                    }
+                    return;
+                }
+            }
+
+            auto const v = static_cast<std::uint64_t>(value);
+            if(v < 0x80)
+            {
+                put(static_cast<std::uint8_t>(v));
+            }
+            else if(v <= std::numeric_limits<std::uint8_t>::max())
+            {
+                put_big_endian(0xcc, static_cast<std::uint8_t>(v));
+            }
+            else if(v <= std::numeric_limits<std::uint16_t>::max())
+            {
+                put_big_endian(0xcd, static_cast<std::uint16_t>(v));
+            }
+            else if(v <= std::numeric_limits<std::uint32_t>::max())
+            {
+                put_big_endian(0xce, static_cast<std::uint32_t>(v));
+            }
+            else
+            {
+                put_big_endian(0xcf, v);
+            }
+        }
+
+        auto write_float(float const value) -> void {
+            put_big_endian(0xca, std::bit_cast<std::uint32_t>(value));
+        }
+
+        auto write_double(double const value) -> void {
+            put_big_endian(0xcb, std::bit_cast<std::uint64_t>(value));
+        }
+
+        auto write_string(std::string_view const str) -> void {
+            write_header(str.size(), 0xa0, 32, 0xd9, 0xda, 0xdb);
+            if constexpr(requires { _buffer.append(str.data(), str.size()); })
+            {
+                _buffer.append(str.data(), str.size());
+            }
+            else
+            {
+                _buffer.insert(_buffer.end(), str.data(), str.data() + str.size());
+            }
+        }
+
+        /**
+         * @brief Start an array of size elements, to be written next
+         */
+        auto write_array_header(std::size_t const size) -> void {
+            write_header(size, 0x90, 16, 0, 0xdc, 0xdd);
+        }
+
+        /**
+         * @brief Start a map of size entries, keys and values to be written next in turn
+         */
+        auto write_map_header(std::size_t const size) -> void {
+            write_header(size, 0x80, 16, 0, 0xde, 0xdf);
+        }
+
+    private:
+        auto put(std::uint8_t const byte) -> void {
+            _buffer.push_back(static_cast<char>(byte));
+        }
+
+        template<typename UInt>
+        auto put_big_endian(std::uint8_t const marker, UInt const value) -> void {
+            std::array<char, sizeof(UInt) + 1> bytes;
+            bytes[0] = static_cast<char>(marker);
+            for(std::size_t i = 0; i < sizeof(UInt); ++i)
+            {
+                bytes[sizeof(UInt) - i] = static_cast<char>(static_cast<std::uint8_t>(value >> (8 * i)));
+            }
+            _buffer.insert(_buffer.end(), bytes.data(), bytes.data() + bytes.size());
+        }
+
+        /**
+         * @param fix marker of the fix format, holding sizes below fix_limit
+         * @param marker8 marker of the 8 bit size format, 0 if the type has none
+         */
+        auto write_header(std::size_t const size, std::uint8_t const fix, std::size_t const fix_limit,
+                          std::uint8_t const marker8, std::uint8_t const marker16, std::uint8_t const marker32) -> void {
+            if(size < fix_limit)
+            {
+                put(static_cast<std::uint8_t>(fix | size));
+            }
+            else if(marker8 != 0 && size <= std::numeric_limits<std::uint8_t>::max())
+            {
+                put_big_endian(marker8, static_cast<std::uint8_t>(size));
+            }
+            else if(size <= std::numeric_limits<std::uint16_t>::max())
+            {
+                put_big_endian(marker16, static_cast<std::uint16_t>(size));
+            }
+            else
+            {
+                put_big_endian(marker32, static_cast<std::uint32_t>(size));
+            }
+        }
+
+        Buffer& _buffer;
+    };
+}
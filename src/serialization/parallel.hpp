@@ -0,0 +1,512 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if __has_include(<sys/uio.h>)
+#include <climits>
+#include <sys/uio.h>
+#define DORI_JSON_HAS_WRITEV 1
+#endif
+
+#include "json_serializer.hpp"
+#include "json_stream.hpp"
+
+namespace dori::json
+{
+    /**
+     * @brief Fork-join pool with one task queue per thread and work stealing
+     *
+     * run(count, task) deals the indices [0, count) out to the threads in contiguous blocks, each thread
+     * pops its own block from the front and, once it is empty, steals from the back of the others.
+     * The calling thread takes part, so a pool of size n starts n - 1 threads.
+     */
+    class thread_pool
+    {
+    public:
+        /**
+         * @param threads number of threads including the caller, 0 for std::thread::hardware_concurrency()
+         */
+        explicit thread_pool(std::size_t const threads = 0) :
+            _queues(std::max<std::size_t>(threads == 0 ? std::thread::hardware_concurrency() : threads, 1))
+        {
+            _workers.reserve(_queues.size() - 1);
+            for(std::size_t i = 1; i < _queues.size(); ++i)
+            {
+                _workers.emplace_back([this, i] { work_loop(i); });
+            }
+        }
+
+        thread_pool(thread_pool const&) = delete;
+        auto operator=(thread_pool const&) -> thread_pool& = delete;
+
+        ~thread_pool() {
+            {
+                std::lock_guard lock(_mutex);
+                _stop = true;
+            }
+            _wake.notify_all();
+            for(auto& worker : _workers)
+            {
+                worker.join();
+            }
+        }
+
+        auto size() const -> std::size_t {
+            return _queues.size();
+        }
+
+        /**
+         * @brief Call task(i) for every i of [0, count) across the pool and wait for all of them
+         *
+         * If tasks throw, the exception of the lowest failing index is rethrown once every task is done.
+         * Not reentrant: a task must not call run on the same pool.
+         */
+        template<typename Task>
+        auto run(std::size_t const count, Task&& task) -> void {
+            if(count == 0)
+            {
+                return;
+            }
+
+            _job = [](void* const context, std::size_t const i) {
+                (*static_cast<std::remove_reference_t<Task>*>(context))(i);
+            };
+            _context = std::addressof(task);
+            _remaining.store(count, std::memory_order_relaxed);
+            _error = nullptr;
+            _error_index = std::numeric_limits<std::size_t>::max();
+
+            for(std::size_t q = 0; q < _queues.size(); ++q)
+            {
+                std::lock_guard lock(_queues[q].mutex);
+                for(std::size_t i = count * q / _queues.size(); i < count * (q + 1) / _queues.size(); ++i)
+                {
+                    _queues[q].indices.push_back(i);
+                }
+            }
+            {
+                std::lock_guard lock(_mutex);
+                ++_generation;
+            }
+            _wake.notify_all();
+
+            drain(0);
+            {
+                std::unique_lock lock(_mutex);
+                _done.wait(lock, [this] { return _remaining.load(std::memory_order_acquire) == 0; });
+            }
+
+            if(_error)
+            {
+                std::rethrow_exception(_error);
+            }
+        }
+
+    private:
+        struct queue
+        {
+            std::mutex mutex;
+            std::deque<std::size_t> indices;
+        };
+
+        auto take(std::size_t const self) -> std::optional<std::size_t> {
+            {
+                std::lock_guard lock(_queues[self].mutex);
+                if(!_queues[self].indices.empty())
+                {
+                    auto const i = _queues[self].indices.front();
+                    _queues[self].indices.pop_front();
+                    return i;
+                }
+            }
+            for(std::size_t offset = 1; offset < _queues.size(); ++offset)
+            {
+                auto& victim = _queues[(self + offset) % _queues.size()];
+                std::lock_guard lock(victim.mutex);
+                if(!victim.indices.empty())
+                {
+                    auto const i = victim.indices.back();
+                    victim.indices.pop_back();
+                    return i;
+                }
+            }
+            return std::nullopt;
+        }
+
+        auto drain(std::size_t const self) -> void {
+            while(auto const i = take(self))
+            {
+                try
+                {
+                    _job(_context, *i);
+                }
+                catch(...)
+                {
+                    std::lock_guard lock(_mutex);
+                    if(*i < _error_index)
+                    {
+                        _error_index = *i;
+                        _error = std::current_exception();
+                    }
+                }
+                if(_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    std::lock_guard lock(_mutex);
+                    _done.notify_all();
+                }
+            }
+        }
+
+        auto work_loop(std::size_t const self) -> void {
+            std::size_t seen = 0;
+            while(true)
+            {
+                {
+                    std::unique_lock lock(_mutex);
+                    _wake.wait(lock, [&] { return _stop || _generation != seen; });
+                    if(_stop)
+                    {
+                        return;
+                    }
+                    seen = _generation;
+                }
+                drain(self);
+            }
+        }
+
+        std::vector<queue> _queues;
+        std::vector<std::thread> _workers;
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _done;
+        std::size_t _generation = 0;
+        bool _stop = false;
+
+        void (*_job)(void*, std::size_t) = nullptr;
+        void* _context = nullptr;
+        std::atomic<std::size_t> _remaining{0};
+        std::exception_ptr _error;
+        std::size_t _error_index = 0;
+    };
+
+    /**
+     * @brief Split an NDJSON input in about count chunks of whole lines
+     */
+    inline auto split_lines(std::string_view const input, std::size_t const count) -> std::vector<std::string_view> {
+        std::vector<std::string_view> chunks;
+        chunks.reserve(count);
+        std::size_t begin = 0;
+        for(std::size_t c = 1; c <= count && begin < input.size(); ++c)
+        {
+            std::size_t end = input.size();
+            if(c < count)
+            {
+                end = std::max(input.size() * c / count, begin);
+                auto const newline = input.find('\n', end);
+                end = newline == std::string_view::npos ? input.size() : newline + 1;
+            }
+            chunks.push_back(input.substr(begin, end - begin));
+            begin = end;
+        }
+        return chunks;
+    }
+
+    /**
+     * @brief Texts of the elements of a top-level json array, found with reader::read_raw bracket matching
+     * @throws nlohmann::json::parse_error if input is not an array
+     */
+    inline auto split_array(std::string_view const input) -> std::vector<std::string_view> {
+        std::vector<std::string_view> elements;
+        reader r(input);
+        if(!r.expect('['))
+        {
+            throw_error(r);
+        }
+        if(!r.consume(']'))
+        {
+            do
+            {
+                std::string_view element;
+                if(!r.read_raw(element))
+                {
+                    throw_error(r);
+                }
+                elements.push_back(element);
+            }
+            while(r.consume(','));
+
+            if(!r.expect(']'))
+            {
+                throw_error(r);
+            }
+        }
+        if(!r.finish())
+        {
+            throw_error(r);
+        }
+        return elements;
+    }
+
+    /**
+     * @brief Below this many elements, write_json_parallel renders on the calling thread only
+     */
+    constexpr std::size_t default_parallel_threshold = 4096;
+
+    /**
+     * @brief Render the elements of values as the inside of a json array, in ordered chunks rendered in parallel
+     *
+     * Chunk c > 0 starts with the ',' separating it from chunk c - 1, so the concatenation of the chunks
+     * is the text between the brackets of the sequential rendering.
+     */
+    template<typename T, template<typename> typename Registry>
+    auto render_chunks(std::span<T const> const values, thread_pool& pool, write_options const& options) -> std::vector<std::string> {
+        constexpr std::size_t chunks_per_thread = 4;
+        auto const count = std::min(pool.size() * chunks_per_thread, values.size());
+
+        std::vector<std::string> chunks(count);
+        pool.run(count, [&](std::size_t const c) {
+            auto const first = values.size() * c / count;
+            auto const last = values.size() * (c + 1) / count;
+            writer<std::string> w(chunks[c], options);
+            for(auto i = first; i < last; ++i)
+            {
+                if(i != 0)
+                {
+                    w.put(',');
+                }
+                write_json_value<T, Registry>(w, values[i]);
+            }
+        });
+        return chunks;
+    }
+
+    /**
+     * @brief Decode every line of an NDJSON chunk, skipping blank lines
+     */
+    template<typename T, template<typename> typename Registry>
+    auto decode_lines(std::string_view chunk, std::vector<T>& out) -> void {
+        auto& serializer = get_serializer<T, Registry>();
+        while(!chunk.empty())
+        {
+            auto const newline = chunk.find('\n');
+            auto const line = chunk.substr(0, newline);
+            chunk.remove_prefix(newline == std::string_view::npos ? chunk.size() : newline + 1);
+            if(line.find_first_not_of(" \t\r") != std::string_view::npos)
+            {
+                serializer.template deserialize_into<T, Registry>(out.emplace_back(), line);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Decode a large NDJSON or top-level array input on a pool of threads, records come out in input order
+ *
+ * NDJSON is split at newlines in a few chunks per thread, arrays at their top-level elements found by a
+ * structural pre-scan; chunks are decoded in per-chunk vectors on a work-stealing pool and merged in order.
+ *
+ * @param threads number of decoding threads, 0 for std::thread::hardware_concurrency()
+ * @throws the exception of the first failing record in input order, like read_json<T, Registry>
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto read_json_parallel(std::string_view const input, dori::json::thread_pool& pool, dori::json::stream_format const format = dori::json::stream_format::ndjson) -> std::vector<T> {
+    constexpr std::size_t chunks_per_thread = 4;
+    auto const chunk_count = pool.size() * chunks_per_thread;
+
+    std::vector<std::vector<T>> outputs;
+    if(format == dori::json::stream_format::ndjson)
+    {
+        auto const chunks = dori::json::split_lines(input, chunk_count);
+        outputs.resize(chunks.size());
+        pool.run(chunks.size(), [&](std::size_t const c) {
+            dori::json::decode_lines<T, Registry>(chunks[c], outputs[c]);
+        });
+    }
+    else
+    {
+        auto const elements = dori::json::split_array(input);
+        auto const count = std::min(chunk_count, elements.size());
+        outputs.resize(count);
+        pool.run(count, [&](std::size_t const c) {
+            auto& serializer = get_serializer<T, Registry>();
+            auto const first = elements.size() * c / count;
+            auto const last = elements.size() * (c + 1) / count;
+            outputs[c].reserve(last - first);
+            for(auto i = first; i < last; ++i)
+            {
+                serializer.template deserialize_into<T, Registry>(outputs[c].emplace_back(), elements[i]);
+            }
+        });
+    }
+
+    std::size_t total = 0;
+    for(auto const& output : outputs)
+    {
+        total += output.size();
+    }
+    std::vector<T> records;
+    records.reserve(total);
+    for(auto& output : outputs)
+    {
+        std::move(output.begin(), output.end(), std::back_inserter(records));
+    }
+    return records;
+}
+
+/**
+ * @brief Same as above on a pool of threads threads (0 for std::thread::hardware_concurrency()) created for the call
+ */
+template<typename T, template<typename> typename Registry> requires(refl::registered<T, Registry>)
+auto read_json_parallel(std::string_view const input, dori::json::stream_format const format = dori::json::stream_format::ndjson, std::size_t const threads = 0) -> std::vector<T> {
+    dori::json::thread_pool pool(threads);
+    return read_json_parallel<T, Registry>(input, pool, format);
+}
+
+/**
+ * @brief T views its input through borrowed or lazy members, which would dangle once the temporary input is destroyed
+ */
+template<typename T, template<typename> typename Registry, typename String> requires(dori::json::dangling_input<String, T, Registry>)
+auto read_json_parallel(String&& input, dori::json::thread_pool& pool, dori::json::stream_format format = dori::json::stream_format::ndjson) -> std::vector<T> = delete;
+
+template<typename T, template<typename> typename Registry, typename String> requires(dori::json::dangling_input<String, T, Registry>)
+auto read_json_parallel(String&& input, dori::json::stream_format format = dori::json::stream_format::ndjson, std::size_t threads = 0) -> std::vector<T> = delete;
+
+/**
+ * @brief Append the json array of values to buffer, rendering large ranges on a pool of threads
+ *
+ * Each thread renders a contiguous part of values into its own buffer, the buffers are then appended in order,
+ * so the text is byte-identical to the sequential rendering of the range with the same options. Ranges of less
+ * than threshold elements are rendered on the calling thread, as are reflected elements written column by column
+ * with {.arrays = dori::json::array_encoding::columns}, since every column spans the whole range.
+ * @param options see write_json
+ */
+template<typename T, template<typename> typename Registry, dori::json::output_buffer Buffer>
+auto write_json_parallel(std::span<T const> const values, Buffer& buffer, dori::json::thread_pool& pool, std::size_t const threshold = dori::json::default_parallel_threshold,
+                         dori::json::write_options const& options = {}) -> void {
+    dori::json::writer<Buffer> w(buffer, options);
+    if constexpr(std::is_pointer_v<T> == false && refl::registered<T, Registry>)
+    {
+        if(options.arrays == dori::json::array_encoding::columns)
+        {
+            dori::json::write_columns<T, Registry>(w, values);
+            return;
+        }
+    }
+    if(values.size() < threshold || pool.size() == 1)
+    {
+        w.put('[');
+        for(std::size_t i = 0; i < values.size(); ++i)
+        {
+            if(i != 0)
+            {
+                w.put(',');
+            }
+            write_json_value<T, Registry>(w, values[i]);
+        }
+        w.put(']');
+        return;
+    }
+
+    auto const chunks = dori::json::render_chunks<T, Registry>(values, pool, options);
+    if constexpr(requires { buffer.reserve(std::size_t{}); buffer.size(); })
+    {
+        std::size_t size = buffer.size() + 2;
+        for(auto const& chunk : chunks)
+        {
+            size += chunk.size();
+        }
+        buffer.reserve(size);
+    }
+    w.put('[');
+    for(auto const& chunk : chunks)
+    {
+        w.write_raw(chunk);
+    }
+    w.put(']');
+}
+
+#if defined(DORI_JSON_HAS_WRITEV)
+/**
+ * @brief Write the json array of values to the file descriptor fd, handing the per-thread buffers to writev(2) in order
+ * instead of concatenating them
+ *
+ * @throws std::system_error if writev fails
+ */
+template<typename T, template<typename> typename Registry>
+auto write_json_parallel(std::span<T const> const values, int const fd, dori::json::thread_pool& pool, std::size_t const threshold = dori::json::default_parallel_threshold,
+                         dori::json::write_options const& options = {}) -> void {
+    std::vector<std::string> chunks;
+    bool const sequential = [&] {
+        if constexpr(std::is_pointer_v<T> == false && refl::registered<T, Registry>)
+        {
+            return options.arrays == dori::json::array_encoding::columns;
+        }
+        else
+        {
+            return false;
+        }
+    }();
+    if(sequential || values.size() < threshold || pool.size() == 1)
+    {
+        chunks.emplace_back();
+        write_json_parallel<T, Registry>(values, chunks.back(), pool, threshold, options);
+    }
+    else
+    {
+        chunks = dori::json::render_chunks<T, Registry>(values, pool, options);
+        chunks.insert(chunks.begin(), "[");
+        chunks.emplace_back("]");
+    }
+
+    std::vector<iovec> pending;
+    pending.reserve(chunks.size());
+    for(auto& chunk : chunks)
+    {
+        if(!chunk.empty())
+        {
+            pending.push_back(iovec{chunk.data(), chunk.size()});
+        }
+    }
+
+    std::size_t next = 0;
+    while(next < pending.size())
+    {
+        auto const batch = static_cast<int>(std::min<std::size_t>(pending.size() - next, IOV_MAX));
+        auto written = ::writev(fd, pending.data() + next, batch);
+        if(written < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "json parallel: writev failed");
+        }
+        // skip what was written, resuming a partially written buffer
+        for(; next < pending.size() && static_cast<std::size_t>(written) >= pending[next].iov_len; ++next)
+        {
+            written -= static_cast<decltype(written)>(pending[next].iov_len);
+        }
+        if(written > 0)
+        {
+            pending[next].iov_base = static_cast<char*>(pending[next].iov_base) + written;
+            pending[next].iov_len -= static_cast<std::size_t>(written);
+        }
+    }
+}
+#endif
@@ -0,0 +1,315 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <ranges>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "json_serializer.hpp"
+
+namespace dori::meta
+{
+    /**
+     * @brief String literal usable as a template argument, e.g. template<fixed_string Name>
+     */
+    template<std::size_t N>
+    struct fixed_string
+    {
+        std::array<char, N> chars{};
+
+        constexpr fixed_string(char const (&str)[N]) {
+            for(std::size_t i = 0; i < N; ++i)
+            {
+                chars[i] = str[i];
+            }
+        }
+
+        constexpr auto view() const -> std::string_view {
+            return std::string_view(chars.data(), N - 1);
+        }
+    };
+
+    /**
+     * @brief Set of dotted member paths ("success", "data.token"), usable as a template argument
+     *
+     * Capacity and MaxCount are those of the top level set, sub-sets returned by below() keep them
+     * so a projection and all its sub-projections share one type family.
+     */
+    template<std::size_t Capacity, std::size_t MaxCount>
+    struct path_set
+    {
+        std::array<char, Capacity> chars{};
+        std::array<std::size_t, MaxCount> begins{};
+        std::array<std::size_t, MaxCount> sizes{};
+        std::size_t count = 0;
+
+        constexpr auto path(std::size_t const i) const -> std::string_view {
+            return std::string_view(chars.data() + begins[i], sizes[i]);
+        }
+
+        constexpr auto add(std::string_view const path) -> void {
+            std::size_t const begin = count == 0 ? 0 : begins[count - 1] + sizes[count - 1];
+            for(std::size_t i = 0; i < path.size(); ++i)
+            {
+                chars[begin + i] = path[i];
+            }
+            begins[count] = begin;
+            sizes[count] = path.size();
+            ++count;
+        }
+
+        constexpr auto empty() const -> bool {
+            return count == 0;
+        }
+
+        /**
+         * @brief Whether name itself is selected, with everything below it
+         */
+        constexpr auto selects(std::string_view const name) const -> bool {
+            for(std::size_t i = 0; i < count; ++i)
+            {
+                if(path(i) == name)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief Whether some path goes below name
+         */
+        constexpr auto descends(std::string_view const name) const -> bool {
+            for(std::size_t i = 0; i < count; ++i)
+            {
+                if(path(i).size() > name.size() && path(i).starts_with(name) && path(i)[name.size()] == '.')
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief The paths going below name, relative to it
+         */
+        constexpr auto below(std::string_view const name) const -> path_set {
+            path_set result;
+            for(std::size_t i = 0; i < count; ++i)
+            {
+                if(path(i).size() > name.size() && path(i).starts_with(name) && path(i)[name.size()] == '.')
+                {
+                    result.add(path(i).substr(name.size() + 1));
+                }
+            }
+            return result;
+        }
+
+        /**
+         * @brief Whether the first segment of every path is one of names
+         */
+        template<std::size_t N>
+        constexpr auto within(std::array<std::string_view, N> const& names) const -> bool {
+            for(std::size_t i = 0; i < count; ++i)
+            {
+                auto const first = path(i).substr(0, path(i).find('.'));
+                bool found = false;
+                for(auto const name : names)
+                {
+                    found = found || name == first;
+                }
+                if(!found)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    template<fixed_string... Paths>
+    constexpr auto make_path_set() {
+        path_set<(std::size_t{0} + ... + Paths.view().size()) + 1, sizeof...(Paths) + 1> paths;
+        (paths.add(Paths.view()), ...);
+        return paths;
+    }
+}
+
+namespace dori::json
+{
+    /**
+     * @brief Tag selecting the members a projected decode reads, see fields
+     */
+    template<auto Paths>
+    struct projection
+    {
+        static constexpr auto paths = Paths;
+    };
+
+    /**
+     * @brief Projection on the members named by Paths, dotted paths going through nested reflected types
+     * (std::optional, std::vector in either layout, maps and arrays of them are traversed), e.g. fields<"success", "data.token">
+     */
+    template<dori::meta::fixed_string... Paths>
+    constexpr projection<dori::meta::make_path_set<Paths...>()> fields{};
+
+    template<typename T, template<typename> typename Registry, auto Paths>
+    auto read_projected(reader& reader, T& value) -> bool;
+
+    /**
+     * @brief One reader per field of T for the projection Paths: selected fields are decoded, fields with selected
+     * sub-members are decoded with the sub-projection, the others are skipped and validated
+     */
+    template<typename T, template<typename> typename Registry, auto Paths>
+    constexpr auto projected_readers = []<std::size_t... I>(std::index_sequence<I...>) {
+        return std::array<bool (*)(reader&, T&), sizeof...(I)>{
+            +[](reader& r, T& t) {
+                constexpr auto ptr = dori::meta::field_at<T, Registry, I>.ptr();
+                constexpr auto name = dori::meta::field_names<T, Registry>[I];
+                using field_type = std::remove_cvref_t<decltype(t.*ptr)>;
+
+                if constexpr(Paths.selects(name))
+                {
+                    return read_json_value<field_type, Registry>(r, t.*ptr);
+                }
+                else if constexpr(Paths.descends(name))
+                {
+                    return read_projected<field_type, Registry, Paths.below(name)>(r, t.*ptr);
+                }
+                else
+                {
+                    return r.skip_value();
+                }
+            }...
+        };
+    }(std::make_index_sequence<dori::meta::field_count<T, Registry>>{});
+
+    /**
+     * @brief Decode only the members of value selected by Paths, the others keep their value
+     * @return false on failure, the error is recorded in reader
+     */
+    template<typename T, template<typename> typename Registry, auto Paths>
+    auto read_projected(reader& reader, T& value) -> bool {
+        if constexpr(refl::registered<T, Registry>)
+        {
+            constexpr auto const& names = dori::meta::field_names<T, Registry>;
+            static_assert(Paths.within(names), "projection path does not name a reflected field");
+
+            std::size_t expected = dori::meta::first_field<T, Registry>;
+            std::array<bool, names.size()> seen{};
+            bool const succeeded = reader.read_object([&](std::string_view const key) {
+                auto const index = dori::meta::field_index<T, Registry>::find(key, expected);
+                if(index == dori::meta::field_index<T, Registry>::npos)
+                {
+                    return reader.skip_value();
+                }
+                seen[index] = true;
+                expected = dori::meta::next_field<T, Registry>[index];
+                return projected_readers<T, Registry, Paths>[index](reader, value) || reader.trace_member(names[index]);
+            });
+
+            if(!succeeded)
+            {
+                return false;
+            }
+            for(std::size_t i = 0; i < names.size(); ++i)
+            {
+                if(!seen[i] && (Paths.selects(names[i]) || Paths.descends(names[i])))
+                {
+                    return reader.fail_missing_field(names[i]);
+                }
+            }
+            return true;
+        }
+        else if constexpr(dori::meta::is_optional_v<T>)
+        {
+            if(reader.peek() == 'n')
+            {
+                value.reset();
+                return reader.read_null();
+            }
+            if(!value.has_value())
+            {
+                value.emplace();
+            }
+            return read_projected<typename T::value_type, Registry, Paths>(reader, *value);
+        }
+        else if constexpr(dori::meta::is_map_v<T>)
+        {
+            return read_map(reader, value, [](dori::json::reader& r, dori::meta::map_mapped_t<T>& mapped) {
+                return read_projected<dori::meta::map_mapped_t<T>, Registry, Paths>(r, mapped);
+            });
+        }
+        else if constexpr(dori::meta::is_vector_v<T>)
+        {
+            if constexpr(is_record_vector_v<T, Registry>)
+            {
+                if(reader.peek() == '{')
+                {
+                    using row_type = typename T::value_type;
+                    constexpr auto const& names = dori::meta::field_names<row_type, Registry>;
+                    static_assert(Paths.within(names), "projection path does not name a reflected field");
+                    return read_columns<row_type, Registry>(reader, value, [](std::size_t const index, dori::json::reader& r, row_type& row) {
+                        return projected_readers<row_type, Registry, Paths>[index](r, row);
+                    }, [](std::size_t const index) {
+                        return Paths.selects(names[index]) || Paths.descends(names[index]);
+                    });
+                }
+            }
+            std::size_t i = 0;
+            bool const succeeded = reader.read_array([&] {
+                auto& element = i < value.size() ? value[i] : value.emplace_back();
+                ++i;
+                return read_projected<typename T::value_type, Registry, Paths>(reader, element) || reader.trace_element(i - 1);
+            });
+            value.erase(value.begin() + static_cast<std::ptrdiff_t>(std::min(i, value.size())), value.end());
+            return succeeded;
+        }
+        else if constexpr(std::is_array_v<T> || dori::meta::is_std_array_v<T>)
+        {
+            std::size_t i = 0;
+            bool const succeeded = reader.read_array([&] {
+                if(i == std::size(value))
+                {
+                    return reader.skip_value();
+                }
+                ++i;
+                return read_projected<std::ranges::range_value_t<T>, Registry, Paths>(reader, value[i - 1]) || reader.trace_element(i - 1);
+            });
+            return succeeded && (i == std::size(value) || reader.fail(error_kind::type_mismatch));
+        }
+        else
+        {
+            static_assert(refl::registered<T, Registry>, "projection path goes below a member that is neither reflected nor a container of reflected types");
+        }
+    }
+}
+
+/**
+ * @brief Decode only the members of json_string selected by a projection, e.g. dori::json::fields<"success", "data.token">
+ *
+ * Paths are checked against the reflector names at compile time. Unselected members stay default-initialized and
+ * their subtrees are skipped without being decoded, but still validated like the rest of the input. Selected
+ * members must be present.
+ *
+ * @throws nlohmann::json::parse_error, nlohmann::json::out_of_range, nlohmann::json::type_error like read_json<T, Registry>
+ */
+template<typename T, template<typename> typename Registry, auto Paths> requires(refl::registered<T, Registry>)
+auto from_json(std::string_view const json_string, dori::json::projection<Paths>) -> T {
+    dori::json::reader reader(json_string);
+    T t{};
+    if(!dori::json::read_projected<T, Registry, Paths>(reader, t) || !reader.finish())
+    {
+        dori::json::throw_error(reader);
+    }
+    return t;
+}
+
+/**
+ * @brief T views its input through borrowed or lazy members, which would dangle once the temporary json_string is destroyed
+ */
+template<typename T, template<typename> typename Registry, auto Paths, typename String> requires(dori::json::dangling_input<String, T, Registry>)
+auto from_json(String&& json_string, dori::json::projection<Paths>) -> T = delete;
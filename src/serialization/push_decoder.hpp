@@ -0,0 +1,891 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "json_serializer.hpp"
+
+namespace dori::json
+{
+    namespace detail
+    {
+        /**
+         * @brief Coroutine decoding one json value, started when awaited and resuming its awaiter once it ends
+         *
+         * Awaiting a task transfers control to it without growing the stack, so a chain of nested values suspends
+         * as one: the innermost coroutine waits for input, and is the one resumed when input arrives.
+         */
+        class decode_task
+        {
+        public:
+            struct promise_type;
+
+            /**
+             * @brief Resume the awaiting coroutine, or return to the resumer of a task nobody awaits
+             */
+            struct resume_continuation
+            {
+                auto await_ready() noexcept -> bool {
+                    return false;
+                }
+
+                auto await_suspend(std::coroutine_handle<promise_type> const handle) noexcept -> std::coroutine_handle<> {
+                    return handle.promise().continuation;
+                }
+
+                auto await_resume() noexcept -> void {}
+            };
+
+            struct promise_type
+            {
+                std::exception_ptr error;
+                std::coroutine_handle<> continuation = std::noop_coroutine();
+
+                auto get_return_object() -> decode_task {
+                    return decode_task(std::coroutine_handle<promise_type>::from_promise(*this));
+                }
+
+                auto initial_suspend() noexcept -> std::suspend_always {
+                    return {};
+                }
+
+                auto final_suspend() noexcept -> resume_continuation {
+                    return {};
+                }
+
+                auto return_void() -> void {}
+
+                auto unhandled_exception() -> void {
+                    error = std::current_exception();
+                }
+            };
+
+            explicit decode_task(std::coroutine_handle<promise_type> const handle) :
+                _handle(handle)
+            {}
+
+            decode_task(decode_task&& other) noexcept :
+                _handle(std::exchange(other._handle, nullptr))
+            {}
+
+            decode_task(decode_task const&) = delete;
+            auto operator=(decode_task const&) -> decode_task& = delete;
+            auto operator=(decode_task&&) -> decode_task& = delete;
+
+            ~decode_task() {
+                if(_handle)
+                {
+                    _handle.destroy();
+                }
+            }
+
+            /**
+             * @brief Run the task from the awaiting coroutine, which resumes once the task ends and rethrows its exception
+             */
+            auto operator co_await() && noexcept {
+                struct awaiter
+                {
+                    std::coroutine_handle<promise_type> handle;
+
+                    auto await_ready() noexcept -> bool {
+                        return false;
+                    }
+
+                    auto await_suspend(std::coroutine_handle<> const awaiting) noexcept -> std::coroutine_handle<> {
+                        handle.promise().continuation = awaiting;
+                        return handle;
+                    }
+
+                    auto await_resume() const -> void {
+                        if(handle.promise().error)
+                        {
+                            std::rethrow_exception(handle.promise().error);
+                        }
+                    }
+                };
+                return awaiter{_handle};
+            }
+
+            auto handle() const -> std::coroutine_handle<> {
+                return _handle;
+            }
+
+            /**
+             * @brief Rethrow the exception that ended the task, if any
+             */
+            auto rethrow() const -> void {
+                if(_handle.promise().error)
+                {
+                    std::rethrow_exception(_handle.promise().error);
+                }
+            }
+
+        private:
+            std::coroutine_handle<promise_type> _handle;
+        };
+    }
+
+    /**
+     * @brief Incremental decoder of a registered T from chunks of any size, e.g. as they come out of a socket
+     *
+     * The json text is parsed by coroutines, one per object or array being received, suspended between feed()
+     * calls. Each scalar is decoded into T with the type dispatch of read_json as soon as its last byte arrives,
+     * then dropped: between two feed() calls only the unfinished token (a string, number, literal or key) is
+     * buffered, whatever the nesting, so a big array under "data" is decoded element by element.
+     * Errors are reported with the nlohmann::json exceptions of read_json, at offsets counted from the start
+     * of the input, by the feed() or finish() call that detects them and every call after it.
+     *
+     * With an instrumented registry each reflected object records a decode like with read_json, timed from its
+     * first byte to its last, so including the wait for the chunks in between.
+     *
+     * The decoder is bound to its coroutines, so it can neither be copied nor moved. Since tokens are dropped
+     * once decoded, T must not hold members that view their input (lazy<T>, std::string_view...).
+     */
+    template<typename T, template<typename> typename Registry>
+    class push_decoder
+    {
+        static_assert(!borrows_input_v<T, Registry>, "tokens are dropped once decoded, T must not hold std::string_view, std::span<char const> or lazy members");
+
+    public:
+        push_decoder() :
+            _parser(parse()),
+            _pending{.handle = _parser.handle()}
+        {}
+
+        push_decoder(push_decoder const&) = delete;
+        auto operator=(push_decoder const&) -> push_decoder& = delete;
+
+        /**
+         * @brief Decode what chunk completes
+         * @return true once the whole object has been decoded, after what only whitespaces may be fed
+         */
+        auto feed(std::span<char const> const chunk) -> bool {
+            if(_error)
+            {
+                std::rethrow_exception(_error);
+            }
+            _buffer.append(chunk.data(), chunk.size());
+            try
+            {
+                drive();
+                if(_complete)
+                {
+                    skip_whitespace();
+                    if(_position != _buffer.size())
+                    {
+                        fail("unexpected content after the object");
+                    }
+                }
+            }
+            catch(...)
+            {
+                _error = std::current_exception();
+                throw;
+            }
+            compact();
+            return _complete;
+        }
+
+        auto feed(std::string_view const chunk) -> bool {
+            return feed(std::span<char const>(chunk.data(), chunk.size()));
+        }
+
+        auto done() const -> bool {
+            return _complete;
+        }
+
+        /**
+         * @brief Bytes of input held until the next feed(), those of the unfinished token
+         */
+        auto buffered() const -> std::size_t {
+            return _buffer.size();
+        }
+
+        /**
+         * @brief Signal the end of the input and return the decoded object
+         * @throws nlohmann::json::parse_error if the object is incomplete
+         */
+        auto finish() -> T& {
+            if(_error)
+            {
+                std::rethrow_exception(_error);
+            }
+            if(!_complete)
+            {
+                fail("unexpected end of input");
+            }
+            return _value;
+        }
+
+    private:
+        /**
+         * @brief The coroutine waiting for input, resumed by the feed() after which ready(awaiter) holds
+         */
+        struct pending
+        {
+            std::coroutine_handle<> handle;
+            void* awaiter = nullptr;
+            bool (*ready)(void*) = nullptr;
+        };
+
+        /**
+         * @brief Base of the awaiters that suspend until Awaiter::ready() finds what it waits for in the input
+         */
+        template<typename Awaiter>
+        struct input_awaiter
+        {
+            push_decoder& decoder;
+
+            auto await_ready() -> bool {
+                return static_cast<Awaiter&>(*this).ready();
+            }
+
+            auto await_suspend(std::coroutine_handle<> const handle) -> void {
+                decoder._pending = pending{.handle = handle, .awaiter = static_cast<Awaiter*>(this), .ready = [](void* const awaiter) {
+                    return static_cast<Awaiter*>(awaiter)->ready();
+                }};
+            }
+        };
+
+        /**
+         * @brief Wait for the next non-whitespace character, returned without consuming it
+         */
+        struct next_character : input_awaiter<next_character>
+        {
+            auto ready() -> bool {
+                return this->decoder.next_token();
+            }
+
+            auto await_resume() const -> char {
+                return this->decoder._buffer[this->decoder._position];
+            }
+        };
+
+        /**
+         * @brief Wait for the whole scalar token, then decode it with read(reader)
+         */
+        template<typename Read>
+        struct token : input_awaiter<token<Read>>
+        {
+            Read read;
+
+            auto ready() -> bool {
+                return this->decoder.whole_token();
+            }
+
+            auto await_resume() -> void {
+                this->decoder.read_token(read);
+            }
+        };
+
+        /**
+         * @brief Walk the members of an object: each co_await consumes the next key and its ':' and returns true,
+         * the key then in key, or consumes the closing '}' and returns false
+         */
+        struct object_members : input_awaiter<object_members>
+        {
+            enum class step
+            {
+                open,
+                first,
+                next,
+                key,
+                colon
+            };
+
+            std::string key{};
+            step at = step::open;
+            bool member = false;
+
+            auto ready() -> bool {
+                auto& d = this->decoder;
+                while(d.next_token())
+                {
+                    char const c = d._buffer[d._position];
+                    switch(at)
+                    {
+                        case step::open:
+                            if(c != '{')
+                            {
+                                d.mismatch();
+                            }
+                            ++d._position;
+                            at = step::first;
+                            break;
+                        case step::first:
+                        case step::next:
+                            if(c == '}')
+                            {
+                                ++d._position;
+                                member = false;
+                                return true;
+                            }
+                            if(at == step::next)
+                            {
+                                if(c != ',')
+                                {
+                                    d.fail("expected ',' or '}'");
+                                }
+                                ++d._position;
+                            }
+                            at = step::key;
+                            break;
+                        case step::key:
+                            if(c != '"')
+                            {
+                                d.fail("expected an object key");
+                            }
+                            if(!d.whole_token())
+                            {
+                                return false;
+                            }
+                            d.read_token([this](reader& r) {
+                                return r.read_string(key);
+                            });
+                            at = step::colon;
+                            break;
+                        case step::colon:
+                            if(c != ':')
+                            {
+                                d.fail("expected ':'");
+                            }
+                            ++d._position;
+                            at = step::next;
+                            member = true;
+                            return true;
+                    }
+                }
+                return false;
+            }
+
+            auto await_resume() const -> bool {
+                return member;
+            }
+        };
+
+        /**
+         * @brief Walk the elements of an array: each co_await returns true before the next element, left to read,
+         * or consumes the closing ']' and returns false
+         */
+        struct array_elements : input_awaiter<array_elements>
+        {
+            enum class step
+            {
+                open,
+                first,
+                next
+            };
+
+            step at = step::open;
+            bool element = false;
+
+            auto ready() -> bool {
+                auto& d = this->decoder;
+                while(d.next_token())
+                {
+                    char const c = d._buffer[d._position];
+                    if(at == step::open)
+                    {
+                        if(c != '[')
+                        {
+                            d.mismatch();
+                        }
+                        ++d._position;
+                        at = step::first;
+                        continue;
+                    }
+                    if(c == ']')
+                    {
+                        ++d._position;
+                        element = false;
+                        return true;
+                    }
+                    if(at == step::next)
+                    {
+                        if(c != ',')
+                        {
+                            d.fail("expected ',' or ']'");
+                        }
+                        ++d._position;
+                    }
+                    at = step::next;
+                    element = true;
+                    return true;
+                }
+                return false;
+            }
+
+            auto await_resume() const -> bool {
+                return element;
+            }
+        };
+
+        /**
+         * @brief Counts the coroutines decoding nested values, to refuse inputs nested deeper than the reader accepts
+         */
+        class nesting
+        {
+        public:
+            explicit nesting(push_decoder& decoder) :
+                _decoder(decoder)
+            {
+                if(_decoder._depth == reader::max_depth)
+                {
+                    _decoder.fail("nesting deeper than " + std::to_string(reader::max_depth));
+                }
+                ++_decoder._depth;
+            }
+
+            nesting(nesting const&) = delete;
+            auto operator=(nesting const&) -> nesting& = delete;
+
+            ~nesting() {
+                --_decoder._depth;
+            }
+
+        private:
+            push_decoder& _decoder;
+        };
+
+        /**
+         * @brief Whether U is read from a single token, in place by the coroutine of the enclosing object or array
+         */
+        template<typename U>
+        static consteval auto is_scalar() -> bool {
+            if constexpr(dori::meta::is_optional_v<U>)
+            {
+                return is_scalar<typename U::value_type>();
+            }
+            else
+            {
+                return dori::meta::is_string_v<U> || std::is_assignable_v<U&, std::string const&> || std::is_arithmetic_v<U>;
+            }
+        }
+        [[noreturn]] auto fail(std::string_view const message) const -> void {
+            throw nlohmann::json::parse_error::create(101, offset() + 1, "syntax error: " + std::string(message), nullptr);
+        }
+
+        [[noreturn]] auto mismatch() const -> void {
+            throw nlohmann::json::type_error::create(302, "unexpected value type at byte " + std::to_string(offset() + 1), nullptr);
+        }
+
+        /**
+         * @brief Offset of the current position in the whole input
+         */
+        auto offset() const -> std::size_t {
+            return _consumed + _position;
+        }
+
+        auto skip_whitespace() -> void {
+            while(_position < _buffer.size() && kernels::scalar::is_whitespace(_buffer[_position]))
+            {
+                ++_position;
+            }
+        }
+
+        /**
+         * @brief Skip whitespaces, false if the next character has not arrived yet
+         */
+        auto next_token() -> bool {
+            skip_whitespace();
+            return _position != _buffer.size();
+        }
+
+        /**
+         * @brief Whether the scalar token at the next character has fully arrived, its length then in _token_length
+         *
+         * A '{' or '[' is taken as a one-character token, for the reader to report the type mismatch.
+         */
+        auto whole_token() -> bool {
+            if(!next_token())
+            {
+                return false;
+            }
+            char const c = _buffer[_position];
+            if(c == '{' || c == '[')
+            {
+                _token_length = 1;
+                return true;
+            }
+            _token_length = _scanner.scan(std::string_view(_buffer).substr(_position));
+            return _token_length != value_scanner::npos;
+        }
+
+        /**
+         * @brief Decode the token found by whole_token() with read(reader), then consume it
+         */
+        template<typename Read>
+        auto read_token(Read&& read) -> void {
+            reader r(std::string_view(_buffer).substr(_position, _token_length));
+            if(!read(r) || !r.finish())
+            {
+                throw_error(r, offset());
+            }
+            _position += _token_length;
+            _scanner.reset();
+        }
+
+        /**
+         * @brief Drop the consumed input so the buffer only holds the unfinished token
+         */
+        auto compact() -> void {
+            _buffer.erase(0, _position);
+            _consumed += _position;
+            _position = 0;
+        }
+
+        /**
+         * @brief Resume the coroutine waiting for input if what it waits for has arrived, until it waits again
+         */
+        auto drive() -> void {
+            if(_pending.handle && (_pending.ready == nullptr || _pending.ready(_pending.awaiter)))
+            {
+                std::exchange(_pending, pending{}).handle.resume();
+            }
+            _parser.rethrow();
+        }
+
+        auto peek() -> next_character {
+            return next_character{{*this}};
+        }
+
+        template<typename Read>
+        auto scalar(Read read) -> token<Read> {
+            return token<Read>{{*this}, std::move(read)};
+        }
+
+        /**
+         * @brief Awaitable decoding the next value into target: a scalar is read in place once its token has arrived,
+         * an object or array by a nested coroutine
+         */
+        template<typename U>
+        auto read(U& target) {
+            if constexpr(is_scalar<U>())
+            {
+                return scalar([&target](reader& r) {
+                    return read_json_value<U, Registry>(r, target);
+                });
+            }
+            else if constexpr(std::is_pointer_v<U> == false && refl::registered<U, Registry> && !dori::meta::instrumentation_t<U, Registry>::enabled)
+            {
+                return read_object(target);
+            }
+            else
+            {
+                return read_nested(target);
+            }
+        }
+
+        auto parse() -> detail::decode_task {
+            co_await read(_value);
+            _complete = true;
+        }
+
+        /**
+         * @brief Decode the members of a reflected object: every reflected field must be present and unknown keys are skipped
+         */
+        template<typename S>
+        auto read_object(S& target) -> detail::decode_task {
+            nesting const level(*this);
+            std::array<bool, dori::meta::field_count<S, Registry>> seen{};
+            std::size_t expected = dori::meta::first_field<S, Registry>;
+
+            object_members object{{*this}};
+            while(co_await object)
+            {
+                auto const index = dori::meta::field_index<S, Registry>::find(object.key, expected);
+                if(index == dori::meta::field_index<S, Registry>::npos)
+                {
+                    co_await skip();
+                    continue;
+                }
+                seen[index] = true;
+                expected = dori::meta::next_field<S, Registry>[index];
+                if(auto const read_field = field_decoders<S>[index])
+                {
+                    co_await read_field(*this, target);
+                }
+                else
+                {
+                    co_await scalar([&target, index](reader& r) {
+                        return get_serializer<S, Registry>().template read_field<S, Registry>(index, r, target);
+                    });
+                }
+            }
+            require_fields<S>(seen);
+        }
+
+        /**
+         * @brief Decode rows written as {"key":[value,...],...}, like dori::json::read_columns
+         */
+        template<typename Vector>
+        auto read_columns(Vector& rows) -> detail::decode_task {
+            using row_type = typename Vector::value_type;
+            constexpr auto unknown = static_cast<std::size_t>(-1);
+            nesting const level(*this);
+            std::array<bool, dori::meta::field_count<row_type, Registry>> seen{};
+            std::size_t expected = dori::meta::first_field<row_type, Registry>;
+            std::size_t size = unknown;
+
+            object_members columns{{*this}};
+            while(co_await columns)
+            {
+                auto const index = dori::meta::field_index<row_type, Registry>::find(columns.key, expected);
+                if(index == dori::meta::field_index<row_type, Registry>::npos)
+                {
+                    co_await skip();
+                    continue;
+                }
+                seen[index] = true;
+                expected = dori::meta::next_field<row_type, Registry>[index];
+
+                std::size_t i = 0;
+                array_elements cells{{*this}};
+                while(co_await cells)
+                {
+                    if(i == size)
+                    {
+                        mismatch();
+                    }
+                    auto& row = i < rows.size() ? rows[i] : rows.emplace_back();
+                    ++i;
+                    if(auto const read_field = field_decoders<row_type>[index])
+                    {
+                        co_await read_field(*this, row);
+                    }
+                    else
+                    {
+                        co_await scalar([&row, index](reader& r) {
+                            return get_serializer<row_type, Registry>().template read_field<row_type, Registry>(index, r, row);
+                        });
+                    }
+                }
+                if(size == unknown)
+                {
+                    size = i;
+                    rows.erase(rows.begin() + static_cast<std::ptrdiff_t>(size), rows.end());
+                }
+                if(i != size)
+                {
+                    mismatch();
+                }
+            }
+            if(size == unknown)
+            {
+                rows.clear();
+            }
+            require_fields<row_type>(seen);
+        }
+
+        /**
+         * @brief Decode the values that are neither scalars nor uninstrumented reflected objects, like read_json_value
+         */
+        template<typename U>
+        auto read_nested(U& target) -> detail::decode_task {
+            nesting const level(*this);
+            if constexpr(dori::meta::is_optional_v<U>)
+            {
+                if(co_await peek() == 'n')
+                {
+                    co_await scalar([&target](reader& r) {
+                        return read_json_value<U, Registry>(r, target);
+                    });
+                }
+                else
+                {
+                    if(!target.has_value())
+                    {
+                        target.emplace();
+                    }
+                    co_await read(*target);
+                }
+            }
+            else if constexpr(std::is_pointer_v<U> == false && refl::registered<U, Registry>)
+            {
+                using instrumentation = dori::meta::instrumentation_t<U, Registry>;
+                typename instrumentation::template probe<U, Registry> probe(Registry<U>::reflector.name(), dori::json::operation::decode);
+                co_await peek();
+                auto const start = offset();
+                co_await read_object(target);
+                probe.done(offset() - start);
+            }
+            else if constexpr(dori::meta::is_map_v<U>)
+            {
+                // entries come either as one {"key":value,...} object or as an array of {"key":value} objects
+                target.clear();
+                bool const listed = co_await peek() == '[';
+                array_elements list{{*this}};
+                while(true)
+                {
+                    if(listed)
+                    {
+                        if(!co_await list)
+                        {
+                            break;
+                        }
+                    }
+                    object_members entries{{*this}};
+                    while(co_await entries)
+                    {
+                        auto key = to_map_key<U>(entries.key);
+                        if constexpr(dori::meta::is_vector_map_v<U>)
+                        {
+                            auto& entry = target.emplace_back();
+                            entry.first = std::move(key);
+                            co_await read(entry.second);
+                        }
+                        else
+                        {
+                            co_await read(target.try_emplace(std::move(key)).first->second);
+                        }
+                    }
+                    if(!listed)
+                    {
+                        break;
+                    }
+                }
+                if constexpr(dori::meta::is_vector_map_v<U>)
+                {
+                    if(!std::ranges::is_sorted(target, {}, &U::value_type::first))
+                    {
+                        std::ranges::stable_sort(target, {}, &U::value_type::first);
+                    }
+                }
+            }
+            else if constexpr(std::ranges::range<U>)
+            {
+                if constexpr(std::is_array_v<U> || dori::meta::is_std_array_v<U>)
+                {
+                    std::size_t i = 0;
+                    array_elements array{{*this}};
+                    while(co_await array)
+                    {
+                        if(i == std::size(target))
+                        {
+                            co_await skip();
+                            continue;
+                        }
+                        ++i;
+                        co_await read(target[i - 1]);
+                    }
+                    if(i != std::size(target))
+                    {
+                        mismatch();
+                    }
+                }
+                else if constexpr(dori::meta::is_vector_v<U>)
+                {
+                    if constexpr(dori::json::is_record_vector_v<U, Registry>)
+                    {
+                        if(co_await peek() == '{')
+                        {
+                            co_await read_columns(target);
+                            co_return;
+                        }
+                    }
+                    target.clear();
+                    array_elements array{{*this}};
+                    while(co_await array)
+                    {
+                        co_await read(target.emplace_back());
+                    }
+                }
+                else
+                {
+                    static_assert(std::is_array_v<U> || dori::meta::is_std_array_v<U> || dori::meta::is_vector_v<U>, "array is not supported by the json deserializer, please use std::array, std::vector, a map or plain array");
+                }
+            }
+            else
+            {
+                static_assert(std::is_pointer_v<U>, "Type cannot be reflected. Please provide a reflector for this class ");
+                target = nullptr;
+                co_await skip();
+            }
+        }
+
+        /**
+         * @brief Consume the next value, checking its syntax, e.g. the value of an unknown key
+         */
+        auto skip() -> detail::decode_task {
+            nesting const level(*this);
+            char const c = co_await peek();
+            if(c == '{')
+            {
+                object_members object{{*this}};
+                while(co_await object)
+                {
+                    co_await skip();
+                }
+            }
+            else if(c == '[')
+            {
+                array_elements array{{*this}};
+                while(co_await array)
+                {
+                    co_await skip();
+                }
+            }
+            else
+            {
+                co_await scalar([](reader& r) {
+                    return r.skip_value();
+                });
+            }
+        }
+
+        template<typename S>
+        static auto require_fields(std::array<bool, dori::meta::field_count<S, Registry>> const& seen) -> void {
+            constexpr auto const& names = dori::meta::field_names<S, Registry>;
+            for(std::size_t i = 0; i < names.size(); ++i)
+            {
+                if(!seen[i])
+                {
+                    throw nlohmann::json::out_of_range::create(403, "key '" + std::string(names[i]) + "' not found", nullptr);
+                }
+            }
+        }
+
+        template<typename S, std::size_t I>
+        static constexpr auto field_decoder = []() -> detail::decode_task (*)(push_decoder&, S&) {
+            using field_type = std::remove_cvref_t<decltype(std::declval<S&>().*dori::meta::field_at<S, Registry, I>.ptr())>;
+            if constexpr(is_scalar<field_type>())
+            {
+                return nullptr;
+            }
+            else
+            {
+                return +[](push_decoder& decoder, S& s) -> detail::decode_task {
+                    constexpr auto ptr = dori::meta::field_at<S, Registry, I>.ptr();
+                    return decoder.read(s.*ptr);
+                };
+            }
+        }();
+
+        /**
+         * @brief One coroutine per field of S by declaration index, null for the scalar fields read in place
+         */
+        template<typename S>
+        static constexpr auto field_decoders = []<std::size_t... I>(std::index_sequence<I...>) {
+            return std::array<detail::decode_task (*)(push_decoder&, S&), sizeof...(I)>{field_decoder<S, I>...};
+        }(std::make_index_sequence<dori::meta::field_count<S, Registry>>{});
+
+        std::string _buffer;
+        std::size_t _position = 0;
+        std::size_t _consumed = 0;
+        std::size_t _token_length = 0;
+        std::size_t _depth = 0;
+        value_scanner _scanner;
+        T _value{};
+        bool _complete = false;
+        std::exception_ptr _error;
+        detail::decode_task _parser;
+        pending _pending;
+    };
+}
@@ -0,0 +1,225 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(DORI_JSON_NO_SIMD)
+#define DORI_JSON_X86_64 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define DORI_JSON_TARGET_AVX2
+#else
+#define DORI_JSON_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+/**
+ * Byte scanning kernels shared by the json writer and reader.
+ *
+ * find_escape returns the first '"', '\\' or control character (< 0x20) of [first, last), which is
+ * where a writer has to escape and where a reader has to stop a string run.
+ * skip_whitespace returns the first character of [first, last) that is not json whitespace.
+ * Both return last when there is no such character.
+ *
+ * Each kernel has a portable scalar version and, on x86-64, SSE2 and AVX2 versions scanning 16/32
+ * bytes per step. The fastest version the CPU supports is picked once, at the first call.
+ * Define DORI_JSON_NO_SIMD to only build the scalar versions.
+ */
+namespace dori::json::kernels
+{
+    namespace scalar
+    {
+        inline auto is_escape(char const c) -> bool {
+            auto const u = static_cast<unsigned char>(c);
+            return u < 0x20 || u == '"' || u == '\\';
+        }
+
+        inline auto is_whitespace(char const c) -> bool {
+            return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+        }
+
+        inline auto find_escape(char const* first, char const* const last) -> char const* {
+            while(first != last && !is_escape(*first))
+            {
+                ++first;
+            }
+            return first;
+        }
+
+        inline auto skip_whitespace(char const* first, char const* const last) -> char const* {
+            while(first != last && is_whitespace(*first))
+            {
+                ++first;
+            }
+            return first;
+        }
+    }
+
+#if defined(DORI_JSON_X86_64)
+    namespace sse2
+    {
+        inline auto find_escape(char const* first, char const* const last) -> char const* {
+            __m128i const quote = _mm_set1_epi8('"');
+            __m128i const backslash = _mm_set1_epi8('\\');
+            __m128i const control = _mm_set1_epi8(0x1F);
+
+            for(; last - first >= 16; first += 16)
+            {
+                __m128i const chunk = _mm_loadu_si128(reinterpret_cast<__m128i const*>(first));
+                __m128i const is_control = _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk);
+                __m128i const is_escape = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)), is_control);
+                auto const mask = static_cast<std::uint32_t>(_mm_movemask_epi8(is_escape));
+                if(mask != 0)
+                {
+                    return first + std::countr_zero(mask);
+                }
+            }
+            return scalar::find_escape(first, last);
+        }
+
+        inline auto skip_whitespace(char const* first, char const* const last) -> char const* {
+            __m128i const space = _mm_set1_epi8(' ');
+            __m128i const tab = _mm_set1_epi8('\t');
+            __m128i const line_feed = _mm_set1_epi8('\n');
+            __m128i const carriage_return = _mm_set1_epi8('\r');
+
+            for(; last - first >= 16; first += 16)
+            {
+                __m128i const chunk = _mm_loadu_si128(reinterpret_cast<__m128i const*>(first));
+                __m128i const is_whitespace = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+                                                           _mm_or_si128(_mm_cmpeq_epi8(chunk, line_feed), _mm_cmpeq_epi8(chunk, carriage_return)));
+                auto const mask = ~static_cast<std::uint32_t>(_mm_movemask_epi8(is_whitespace)) & 0xFFFFu;
+                if(mask != 0)
+                {
+                    return first + std::countr_zero(mask);
+                }
+            }
+            return scalar::skip_whitespace(first, last);
+        }
+    }
+
+    namespace avx2
+    {
+        DORI_JSON_TARGET_AVX2 inline auto find_escape(char const* first, char const* const last) -> char const* {
+            __m256i const quote = _mm256_set1_epi8('"');
+            __m256i const backslash = _mm256_set1_epi8('\\');
+            __m256i const control = _mm256_set1_epi8(0x1F);
+
+            for(; last - first >= 32; first += 32)
+            {
+                __m256i const chunk = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(first));
+                __m256i const is_control = _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control), chunk);
+                __m256i const is_escape = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)), is_control);
+                auto const mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(is_escape));
+                if(mask != 0)
+                {
+                    return first + std::countr_zero(mask);
+                }
+            }
+            return sse2::find_escape(first, last);
+        }
+
+        DORI_JSON_TARGET_AVX2 inline auto skip_whitespace(char const* first, char const* const last) -> char const* {
+            __m256i const space = _mm256_set1_epi8(' ');
+            __m256i const tab = _mm256_set1_epi8('\t');
+            __m256i const line_feed = _mm256_set1_epi8('\n');
+            __m256i const carriage_return = _mm256_set1_epi8('\r');
+
+            for(; last - first >= 32; first += 32)
+            {
+                __m256i const chunk = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(first));
+                __m256i const is_whitespace = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), _mm256_cmpeq_epi8(chunk, tab)),
+                                                              _mm256_or_si256(_mm256_cmpeq_epi8(chunk, line_feed), _mm256_cmpeq_epi8(chunk, carriage_return)));
+                auto const mask = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(is_whitespace));
+                if(mask != 0)
+                {
+                    return first + std::countr_zero(mask);
+                }
+            }
+            return sse2::skip_whitespace(first, last);
+        }
+    }
+#endif
+
+    enum class isa
+    {
+        scalar,
+        sse2,
+        avx2
+    };
+
+    inline auto detect_isa() -> isa {
+#if defined(DORI_JSON_X86_64)
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        if(info[0] >= 7)
+        {
+            __cpuid(info, 1);
+            bool const os_saves_ymm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+            __cpuidex(info, 7, 0);
+            if(os_saves_ymm && (info[1] & (1 << 5)) != 0)
+            {
+                return isa::avx2;
+            }
+        }
+#else
+        if(__builtin_cpu_supports("avx2"))
+        {
+            return isa::avx2;
+        }
+#endif
+        return isa::sse2;
+#else
+        return isa::scalar;
+#endif
+    }
+
+    struct kernel_set
+    {
+        isa level;
+        char const* (*find_escape)(char const*, char const*);
+        char const* (*skip_whitespace)(char const*, char const*);
+    };
+
+    inline auto kernels_for(isa const level) -> kernel_set {
+        switch(level)
+        {
+#if defined(DORI_JSON_X86_64)
+            case isa::avx2:
+                return {isa::avx2, &avx2::find_escape, &avx2::skip_whitespace};
+            case isa::sse2:
+                return {isa::sse2, &sse2::find_escape, &sse2::skip_whitespace};
+#endif
+            default:
+                return {isa::scalar, &scalar::find_escape, &scalar::skip_whitespace};
+        }
+    }
+
+    /**
+     * @brief Kernels selected for the running CPU
+     */
+    inline auto active() -> kernel_set const& {
+        static kernel_set const selected = kernels_for(detect_isa());
+        return selected;
+    }
+
+    inline auto find_escape(char const* const first, char const* const last) -> char const* {
+        return active().find_escape(first, last);
+    }
+
+    /**
+     * @brief Skip json whitespaces, the common no-whitespace and single-space cases are handled inline
+     */
+    inline auto skip_whitespace(char const* first, char const* const last) -> char const* {
+        if(first != last && scalar::is_whitespace(*first))
+        {
+            ++first;
+            if(first != last && scalar::is_whitespace(*first))
+            {
+                return active().skip_whitespace(first, last);
+            }
+        }
+        return first;
+    }
+}
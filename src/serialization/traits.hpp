@@ -1,9 +1,17 @@
 #pragma once
+#include <charconv>
+#include <concepts>
+#include <cstddef>
 #include <type_traits>
+#include <utility>
 #include <optional>
 #include <array>
 #include <vector>
 #include <map>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
 
 namespace dori::meta
 {
@@ -58,18 +66,179 @@ namespace dori::meta
     template<typename T>
     constexpr bool is_vector_v = is_vector<T>::value;
 
+    /**
+     * @brief std::vector of key-value pairs encoded as a json map and kept sorted by key, opt-in replacement for
+     * std::vector<std::pair<K, V>> which stays an ordinary array
+     */
+    template<typename K, typename V, typename Alloc = std::allocator<std::pair<K, V>>>
+    struct vector_map : std::vector<std::pair<K, V>, Alloc>
+    {
+        using std::vector<std::pair<K, V>, Alloc>::vector;
+    };
+
+    template<typename T>
+    struct is_vector_map
+    {
+        static constexpr bool value = false;
+    };
+
+    template<typename K, typename V, typename Alloc>
+    struct is_vector_map<vector_map<K, V, Alloc>>
+    {
+        static constexpr bool value = true;
+    };
+
+    template<typename T>
+    constexpr bool is_vector_map_v = is_vector_map<T>::value;
+
+    /**
+     * @brief Key-value containers with unique keys, encoded as json maps: std::map, std::unordered_map, std::flat_map
+     * and any container with key_type, mapped_type and try_emplace, and vector_map
+     */
     template<typename T>
     struct is_map
     {
         static constexpr bool value = false;
     };
 
-    template<typename K, typename T, typename Compare, typename Alloc>
-    struct is_map<std::map<K, T, Compare, Alloc>>
+    template<typename T> requires(requires(T& map, typename T::key_type const& key) { typename T::mapped_type; typename T::iterator; map.try_emplace(key); })
+    struct is_map<T>
+    {
+        static constexpr bool value = true;
+        using key_type = typename T::key_type;
+        using mapped_type = typename T::mapped_type;
+    };
+
+    template<typename K, typename V, typename Alloc>
+    struct is_map<vector_map<K, V, Alloc>>
     {
         static constexpr bool value = true;
+        using key_type = K;
+        using mapped_type = V;
     };
 
     template<typename T>
     constexpr bool is_map_v = is_map<T>::value;
+
+    template<typename T>
+    using map_key_t = typename is_map<T>::key_type;
+
+    template<typename T>
+    using map_mapped_t = typename is_map<T>::mapped_type;
+
+    /**
+     * @brief Whether the map iterates in key order (std::map, std::flat_map, vector_map), as opposed to hashed maps
+     */
+    template<typename T>
+    constexpr bool is_ordered_map_v = is_map_v<T> && (is_vector_map_v<T> || requires { typename T::key_compare; });
+
+    template<typename T>
+    struct is_string
+    {
+        static constexpr bool value = false;
+    };
+
+    template<typename Traits, typename Alloc>
+    struct is_string<std::basic_string<char, Traits, Alloc>>
+    {
+        static constexpr bool value = true;
+    };
+
+    template<typename T>
+    constexpr bool is_string_v = is_string<T>::value;
+
+    /**
+     * @brief Conversion of non-string map keys to and from json object keys, specialize it for other key types
+     *
+     * format(key) returns the key text (anything convertible to std::string_view), parse(text, key) returns
+     * false if text is not a valid key.
+     */
+    template<typename K>
+    struct map_key;
+
+    template<std::integral K> requires(!std::is_same_v<K, bool>)
+    struct map_key<K>
+    {
+        struct text
+        {
+            std::array<char, 24> chars;
+            std::size_t size;
+
+            operator std::string_view() const {
+                return std::string_view(chars.data(), size);
+            }
+        };
+
+        static auto format(K const key) -> text {
+            text result;
+            auto const end = std::to_chars(result.chars.data(), result.chars.data() + result.chars.size(), key).ptr;
+            result.size = static_cast<std::size_t>(end - result.chars.data());
+            return result;
+        }
+
+        static auto parse(std::string_view const str, K& key) -> bool {
+            auto const [end, ec] = std::from_chars(str.data(), str.data() + str.size(), key);
+            return ec == std::errc() && end == str.data() + str.size();
+        }
+    };
+
+    /**
+     * @brief Map key types a json object key can hold: strings, or types with a map_key conversion
+     */
+    template<typename K>
+    concept json_map_key = is_string_v<K> || requires(K const& key, K& out, std::string_view const str) {
+        std::string_view(map_key<K>::format(key));
+        { map_key<K>::parse(str, out) } -> std::same_as<bool>;
+    };
+
+    /**
+     * @brief Non owning character views (std::string_view, std::span<char const>) that decode by borrowing from the input
+     */
+    template<typename T>
+    struct is_borrowed_string
+    {
+        static constexpr bool value = false;
+    };
+
+    template<typename Traits>
+    struct is_borrowed_string<std::basic_string_view<char, Traits>>
+    {
+        static constexpr bool value = true;
+    };
+
+    template<>
+    struct is_borrowed_string<std::span<char const>>
+    {
+        static constexpr bool value = true;
+    };
+
+    template<typename T>
+    constexpr bool is_borrowed_string_v = is_borrowed_string<T>::value;
+
+    template<typename T>
+    struct is_polymorphic_allocator
+    {
+        static constexpr bool value = false;
+    };
+
+    template<typename T>
+    struct is_polymorphic_allocator<std::pmr::polymorphic_allocator<T>>
+    {
+        static constexpr bool value = true;
+    };
+
+    /**
+     * @brief Whether T allocates through a std::pmr::memory_resource (std::pmr::string, std::pmr::vector, std::pmr::map...)
+     */
+    template<typename T>
+    constexpr bool uses_memory_resource_v = [] {
+        if constexpr(requires { typename T::allocator_type; })
+        {
+            return is_polymorphic_allocator<typename T::allocator_type>::value;
+        }
+        else
+        {
+            return false;
+        }
+    }();
 }
@@ -0,0 +1,395 @@
+#include <gtest/gtest.h>
+#include <serialization/json_serializer.hpp>
+#include <serialization/msgpack_serializer.hpp>
+#include <serialization/push_decoder.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    std::atomic<std::size_t> allocations{0};
+
+    auto allocate(std::size_t const size, std::size_t const alignment) -> void* {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        if(alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        {
+            return std::malloc(size == 0 ? 1 : size);
+        }
+        return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    }
+
+    auto allocate_or_throw(std::size_t const size, std::size_t const alignment) -> void* {
+        if(void* const p = allocate(size, alignment))
+        {
+            return p;
+        }
+        throw std::bad_alloc();
+    }
+}
+
+// every form of operator new and delete is replaced so each allocation is counted and freed by its matching form
+auto operator new(std::size_t const size) -> void* {
+    return allocate_or_throw(size, 0);
+}
+
+auto operator new[](std::size_t const size) -> void* {
+    return allocate_or_throw(size, 0);
+}
+
+auto operator new(std::size_t const size, std::align_val_t const alignment) -> void* {
+    return allocate_or_throw(size, static_cast<std::size_t>(alignment));
+}
+
+auto operator new[](std::size_t const size, std::align_val_t const alignment) -> void* {
+    return allocate_or_throw(size, static_cast<std::size_t>(alignment));
+}
+
+auto operator new(std::size_t const size, std::nothrow_t const&) noexcept -> void* {
+    return allocate(size, 0);
+}
+
+auto operator new[](std::size_t const size, std::nothrow_t const&) noexcept -> void* {
+    return allocate(size, 0);
+}
+
+auto operator new(std::size_t const size, std::align_val_t const alignment, std::nothrow_t const&) noexcept -> void* {
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+auto operator new[](std::size_t const size, std::align_val_t const alignment, std::nothrow_t const&) noexcept -> void* {
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+auto operator delete(void* const p) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete[](void* const p) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete(void* const p, std::size_t) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete[](void* const p, std::size_t) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete(void* const p, std::align_val_t) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete[](void* const p, std::align_val_t) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete(void* const p, std::size_t, std::align_val_t) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete[](void* const p, std::size_t, std::align_val_t) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete(void* const p, std::nothrow_t const&) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete[](void* const p, std::nothrow_t const&) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete(void* const p, std::align_val_t, std::nothrow_t const&) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete[](void* const p, std::align_val_t, std::nothrow_t const&) noexcept -> void {
+    std::free(p);
+}
+
+struct entry
+{
+    std::string _name;
+    std::vector<int> _scores;
+};
+
+struct message
+{
+    std::string _title;
+    std::vector<entry> _entries;
+    std::map<std::string, entry> _index;
+    std::optional<std::string> _comment;
+};
+
+template<typename T>
+struct allocation_registry {};
+
+template<>
+struct allocation_registry<entry>
+{
+    static constexpr auto reflector = refl::refl<entry>("entry")
+            .add("name", &entry::_name)
+            .add("scores", &entry::_scores);
+};
+
+template<>
+struct allocation_registry<message>
+{
+    static constexpr auto reflector = refl::refl<message>("message")
+            .add("title", &message::_title)
+            .add("entries", &message::_entries)
+            .add("index", &message::_index)
+            .add("comment", &message::_comment);
+};
+
+struct ranking
+{
+    std::map<std::string, int, std::greater<>> _scores;
+};
+
+template<>
+struct allocation_registry<ranking>
+{
+    static constexpr auto reflector = refl::refl<ranking>("ranking")
+            .add("scores", &ranking::_scores);
+};
+
+struct event
+{
+    std::string _kind;
+    std::vector<entry> _entries;
+};
+
+template<typename T>
+struct instrumented_registry {};
+
+template<>
+struct instrumented_registry<entry>
+{
+    using instrumentation = dori::json::counters;
+
+    static constexpr auto reflector = refl::refl<entry>("entry")
+            .add("name", &entry::_name)
+            .add("scores", &entry::_scores);
+};
+
+template<>
+struct instrumented_registry<event>
+{
+    using instrumentation = dori::json::counters;
+
+    static constexpr auto reflector = refl::refl<event>("event")
+            .add("kind", &event::_kind)
+            .add("entries", &event::_entries);
+};
+
+template<typename T>
+struct renamed_registry {};
+
+template<>
+struct renamed_registry<entry>
+{
+    using instrumentation = dori::json::counters;
+
+    static constexpr auto reflector = refl::refl<entry>("renamed entry")
+            .add("name", &entry::_name)
+            .add("scores", &entry::_scores);
+};
+
+namespace
+{
+    auto make_message(char const fill, std::size_t const entries) -> message {
+        message m;
+        m._title = std::string(64, fill);
+        for(std::size_t i = 0; i < entries; ++i)
+        {
+            entry e{._name = std::string(40, fill), ._scores = {1, 2, 3, 4, 5, 6, 7, 8}};
+            m._entries.push_back(e);
+            m._index.emplace("key number " + std::to_string(i) + " long enough to be allocated", e);
+        }
+        m._comment = std::string(48, fill);
+        return m;
+    }
+}
+
+TEST(JsonAllocation, RecycledDecodeDoesNotAllocate)
+{
+    std::string first;
+    std::string second;
+    write_json<message, allocation_registry>(make_message('a', 8), first);
+    write_json<message, allocation_registry>(make_message('b', 8), second);
+
+    message recycled;
+    read_json_into<message, allocation_registry>(first, recycled);
+
+    auto const before = allocations.load();
+    read_json_into<message, allocation_registry>(second, recycled);
+    read_json_into<message, allocation_registry>(first, recycled);
+    auto const after = allocations.load();
+
+    EXPECT_EQ(after - before, 0u);
+
+    std::string written;
+    write_json<message, allocation_registry>(recycled, written);
+    EXPECT_EQ(written, first);
+}
+
+TEST(JsonAllocation, RecycledDecodeDropsLeftovers)
+{
+    std::string large;
+    std::string small;
+    write_json<message, allocation_registry>(make_message('a', 8), large);
+    auto shrunk = make_message('b', 3);
+    shrunk._comment.reset();
+    shrunk._index.erase(shrunk._index.begin());
+    shrunk._index.emplace("a new key", entry{._name = "n", ._scores = {}});
+    write_json<message, allocation_registry>(shrunk, small);
+
+    message recycled;
+    read_json_into<message, allocation_registry>(large, recycled);
+    read_json_into<message, allocation_registry>(small, recycled);
+
+    EXPECT_EQ(recycled._entries.size(), 3u);
+    EXPECT_EQ(recycled._index.size(), 3u);
+    EXPECT_TRUE(recycled._index.contains("a new key"));
+    EXPECT_FALSE(recycled._comment.has_value());
+
+    std::string written;
+    write_json<message, allocation_registry>(recycled, written);
+    EXPECT_EQ(written, small);
+}
+
+TEST(JsonAllocation, RecycledDecodeFollowsMapComparator)
+{
+    ranking const source{._scores = {{"alpha", 1}, {"bravo", 2}, {"delta", 4}}};
+    std::string text;
+    write_json<ranking, allocation_registry>(source, text);
+    EXPECT_EQ(text, "{\"scores\":[{\"delta\":4},{\"bravo\":2},{\"alpha\":1}]}");
+
+    ranking recycled{._scores = {{"echo", 5}, {"charlie", 3}, {"bravo", 0}, {"alpha", 0}}};
+    read_json_into<ranking, allocation_registry>(text, recycled);
+    EXPECT_EQ(recycled._scores, source._scores);
+
+    read_json_into<ranking, allocation_registry>(text, recycled);
+    EXPECT_EQ(recycled._scores, source._scores);
+}
+
+TEST(JsonAllocation, RecycledMsgpackDecodeDoesNotAllocate)
+{
+    auto const first = to_msgpack<message, allocation_registry>(make_message('a', 8));
+    auto const second = to_msgpack<message, allocation_registry>(make_message('b', 8));
+
+    message recycled;
+    read_msgpack_into<message, allocation_registry>(first, recycled);
+
+    auto const before = allocations.load();
+    read_msgpack_into<message, allocation_registry>(second, recycled);
+    read_msgpack_into<message, allocation_registry>(first, recycled);
+    auto const after = allocations.load();
+
+    EXPECT_EQ(after - before, 0u);
+    EXPECT_EQ((to_msgpack<message, allocation_registry>(recycled)), first);
+
+    // ordered maps are merged along their own comparator
+    ranking const source{._scores = {{"alpha", 1}, {"bravo", 2}, {"delta", 4}}};
+    ranking merged{._scores = {{"echo", 5}, {"charlie", 3}, {"bravo", 0}, {"alpha", 0}}};
+    read_msgpack_into<ranking, allocation_registry>(to_msgpack<ranking, allocation_registry>(source), merged);
+    EXPECT_EQ(merged._scores, source._scores);
+}
+
+TEST(JsonAllocation, InstrumentationCountsPerType)
+{
+    static_assert(std::is_same_v<dori::meta::instrumentation_t<message, allocation_registry>, dori::json::no_instrumentation>);
+
+    dori::json::set_allocation_counter([]() noexcept -> std::uint64_t { return allocations.load(); });
+    dori::json::counters::reset();
+
+    event const e{._kind = "a kind long enough to leave the small string buffer",
+                  ._entries = {entry{._name = "first", ._scores = {1, 2}}, entry{._name = "second", ._scores = {}}, entry{._name = "third", ._scores = {3}}}};
+    std::string text;
+    write_json<event, instrumented_registry>(e, text);
+    EXPECT_EQ((to_json<event, instrumented_registry>(e)), text);
+    EXPECT_EQ((read_json<event, instrumented_registry>(text)._entries.size()), 3u);
+    EXPECT_EQ((from_json<event, instrumented_registry>(text)._kind), e._kind);
+    EXPECT_THROW((read_json<event, instrumented_registry>("{\"kind\": 1, \"entries\": []}")), nlohmann::json::type_error);
+    dori::json::set_allocation_counter(nullptr);
+
+    auto const stats = dori::json::counters::snapshot();
+    auto const find = [&](std::string_view const name) {
+        return *std::ranges::find(stats, name, &dori::json::type_stats::name);
+    };
+
+    // the DOM paths record the top-level type only
+    auto const event_stats = find("event");
+    EXPECT_EQ(event_stats.encode.calls, 2u);
+    EXPECT_EQ(event_stats.encode.bytes, 2 * text.size());
+    EXPECT_EQ(event_stats.decode.calls, 3u);
+    EXPECT_EQ(event_stats.decode.failures, 1u);
+    EXPECT_EQ(event_stats.decode.bytes, 2 * text.size());
+    EXPECT_GT(event_stats.decode.allocations, 0u);
+
+    auto const entry_stats = find("entry");
+    EXPECT_EQ(entry_stats.encode.calls, 3u);
+    EXPECT_EQ(entry_stats.encode.bytes, std::string_view("{\"name\":\"first\",\"scores\":[1,2]}{\"name\":\"second\",\"scores\":[]}{\"name\":\"third\",\"scores\":[3]}").size());
+    EXPECT_EQ(entry_stats.decode.calls, 3u);
+    EXPECT_EQ(entry_stats.decode.failures, 0u);
+
+    auto const exported = nlohmann::json::parse(dori::json::counters::export_json());
+    ASSERT_TRUE(exported.is_array());
+    EXPECT_EQ(exported.size(), stats.size());
+    EXPECT_TRUE(std::ranges::any_of(exported, [](nlohmann::json const& type) {
+        return type["name"] == "event" && type["decode"]["failures"] == 1;
+    }));
+}
+
+TEST(JsonAllocation, InstrumentationCountsPushDecodes)
+{
+    dori::json::counters::reset();
+
+    event const e{._kind = "kind", ._entries = {entry{._name = "first", ._scores = {1, 2}}, entry{._name = "second", ._scores = {}}}};
+    std::string text;
+    write_json<event, instrumented_registry>(e, text);
+
+    dori::json::push_decoder<event, instrumented_registry> decoder;
+    for(char const c : text)
+    {
+        decoder.feed(std::string_view(&c, 1));
+    }
+    EXPECT_EQ(decoder.finish()._entries.size(), 2u);
+
+    auto const stats = dori::json::counters::snapshot();
+    auto const find = [&](std::string_view const name) {
+        return *std::ranges::find(stats, name, &dori::json::type_stats::name);
+    };
+    EXPECT_EQ(find("event").decode.calls, 1u);
+    EXPECT_EQ(find("event").decode.bytes, text.size());
+    EXPECT_EQ(find("entry").decode.calls, 2u);
+    EXPECT_EQ(find("entry").decode.failures, 0u);
+    EXPECT_EQ(find("entry").decode.bytes, std::string_view("{\"name\":\"first\",\"scores\":[1,2]}{\"name\":\"second\",\"scores\":[]}").size());
+
+    dori::json::push_decoder<event, instrumented_registry> failing;
+    EXPECT_THROW(failing.feed(std::string_view("{\"kind\": 1, \"entries\": []}")), nlohmann::json::type_error);
+    auto const failed = dori::json::counters::snapshot();
+    EXPECT_EQ(std::ranges::find(failed, "event", &dori::json::type_stats::name)->decode.failures, 1u);
+}
+
+TEST(JsonAllocation, InstrumentationSeparatesRegistries)
+{
+    dori::json::counters::reset();
+
+    entry const e{._name = "first", ._scores = {1, 2}};
+    std::string text;
+    write_json<entry, instrumented_registry>(e, text);
+    write_json<entry, renamed_registry>(e, text);
+    write_json<entry, renamed_registry>(e, text);
+
+    auto const stats = dori::json::counters::snapshot();
+    auto const find = [&](std::string_view const name) {
+        return *std::ranges::find(stats, name, &dori::json::type_stats::name);
+    };
+    EXPECT_EQ(find("entry").encode.calls, 1u);
+    EXPECT_EQ(find("renamed entry").encode.calls, 2u);
+}
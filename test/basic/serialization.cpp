@@ -1,5 +1,21 @@
 #include <gtest/gtest.h>
 #include <serialization/json_serializer.hpp>
+#include <serialization/json_stream.hpp>
+#include <serialization/parallel.hpp>
+#include <serialization/push_decoder.hpp>
+#include <serialization/json_file.hpp>
+#include <serialization/projection.hpp>
+#include <serialization/msgpack_serializer.hpp>
+#include <serialization/merge_patch.hpp>
+
+#include <memory_resource>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <span>
+#include <unordered_map>
+
+#include <unistd.h>
 
 struct data
 {
@@ -25,6 +41,83 @@ auto operator==(foo const& foo1, foo const& foo2) -> bool {
     return foo1._f == foo2._f;
 }
 
+struct sample
+{
+    int _id;
+    std::int64_t _big;
+    double _ratio;
+    double _scale;
+    char _flag;
+    std::string _text;
+    std::array<int, 3> _triple;
+    std::vector<double> _values;
+    std::optional<double> _maybe;
+};
+
+struct numbers
+{
+    std::int8_t _i8;
+    std::uint8_t _u8;
+    std::int16_t _i16;
+    std::int32_t _i32;
+    std::int64_t _i64;
+    std::uint64_t _u64;
+    float _f32;
+    double _f64;
+};
+
+struct pmr_data
+{
+    std::pmr::string _token;
+};
+
+auto operator==(pmr_data const& data1, pmr_data const& data2) -> bool {
+    return data1._token == data2._token;
+}
+
+struct pmr_foo
+{
+    std::pmr::map<std::pmr::string, std::optional<std::pmr::vector<pmr_data>>> _f;
+};
+
+auto operator==(pmr_foo const& foo1, pmr_foo const& foo2) -> bool {
+    return foo1._f == foo2._f;
+}
+
+struct view_data
+{
+    std::string_view _token;
+    std::span<char const> _raw;
+    std::optional<std::string_view> _note;
+    std::string _owned;
+};
+
+struct routed
+{
+    std::string _route;
+    dori::json::lazy<std::optional<std::map<std::string, data>>> _data;
+};
+
+struct tick
+{
+    int _seq;
+    data _head;
+    std::optional<data> _tail;
+    std::vector<int> _values;
+};
+
+struct tape
+{
+    std::vector<tick> _ticks;
+};
+
+struct catalog
+{
+    std::unordered_map<std::string, int> _stock;
+    std::map<int, data> _by_id;
+    dori::meta::vector_map<std::string, int> _flat;
+};
+
 template<typename T>
 struct registry {};
 
@@ -50,6 +143,93 @@ struct registry<foo>
             .add("f", &foo::_f);
 };
 
+template<>
+struct registry<pmr_data>
+{
+    static constexpr auto reflector = refl::refl<pmr_data>("pmr_data")
+            .add("token", &pmr_data::_token);
+};
+
+template<>
+struct registry<pmr_foo>
+{
+    static constexpr auto reflector = refl::refl<pmr_foo>("pmr_foo")
+            .add("f", &pmr_foo::_f);
+};
+
+template<>
+struct registry<view_data>
+{
+    static constexpr auto reflector = refl::refl<view_data>("view_data")
+            .add("token", &view_data::_token)
+            .add("raw", &view_data::_raw)
+            .add("note", &view_data::_note)
+            .add("owned", &view_data::_owned);
+};
+
+template<>
+struct registry<routed>
+{
+    static constexpr auto reflector = refl::refl<routed>("routed")
+            .add("route", &routed::_route)
+            .add("data", &routed::_data);
+};
+
+template<>
+struct registry<tick>
+{
+    static constexpr auto reflector = refl::refl<tick>("tick")
+            .add("seq", &tick::_seq)
+            .add("head", &tick::_head)
+            .add("tail", &tick::_tail)
+            .add("values", &tick::_values);
+};
+
+template<>
+struct registry<tape>
+{
+    static constexpr auto reflector = refl::refl<tape>("tape")
+            .add("ticks", &tape::_ticks);
+};
+
+template<>
+struct registry<catalog>
+{
+    static constexpr auto reflector = refl::refl<catalog>("catalog")
+            .add("stock", &catalog::_stock)
+            .add("by_id", &catalog::_by_id)
+            .add("flat", &catalog::_flat);
+};
+
+template<>
+struct registry<sample>
+{
+    static constexpr auto reflector = refl::refl<sample>("sample")
+            .add("id", &sample::_id)
+            .add("big", &sample::_big)
+            .add("ratio", &sample::_ratio)
+            .add("scale", &sample::_scale)
+            .add("flag", &sample::_flag)
+            .add("text", &sample::_text)
+            .add("triple", &sample::_triple)
+            .add("values", &sample::_values)
+            .add("maybe", &sample::_maybe);
+};
+
+template<>
+struct registry<numbers>
+{
+    static constexpr auto reflector = refl::refl<numbers>("numbers")
+            .add("i8", &numbers::_i8)
+            .add("u8", &numbers::_u8)
+            .add("i16", &numbers::_i16)
+            .add("i32", &numbers::_i32)
+            .add("i64", &numbers::_i64)
+            .add("u64", &numbers::_u64)
+            .add("f32", &numbers::_f32)
+            .add("f64", &numbers::_f64);
+};
+
 TEST(JsonSerialization, FullJson)
 {
     bool succeeded = false;
@@ -257,3 +437,1152 @@ TEST(JsonSerialization, DeserializationSerializationIsIdentity)
 
     ASSERT_TRUE(succeeded);
 }
+
+TEST(JsonSerialization, DirectWriterIsByteIdentical)
+{
+    bool succeeded = false;
+    try
+    {
+        response r;
+        r._success = true;
+        r._data = std::map<std::string, data>{{"1",{._token = ""}},{"2", {._token="gloup"}}};
+
+        foo f{std::map<std::string, std::optional<std::vector<data>>>{
+            {"cccccccccc", std::nullopt},
+            {"bbbbbbbbbb", {std::vector<data>{data{._token="hey1"}, data{._token="hey2"}}}}
+        }};
+
+        sample s{._id = -42,
+                 ._big = 9007199254740993,
+                 ._ratio = 0.1,
+                 ._scale = 1e21,
+                 ._flag = 'x',
+                 ._text = "quote\" backslash\\ tab\t bell\x07 utf8 \xc3\xa9",
+                 ._triple = {1, 2, 3},
+                 ._values = {1.0, -0.0, 123456.789, 1e-7, 0.001, 1.5e300},
+                 ._maybe = std::nullopt};
+
+        std::string response_text = "prefix:";
+        write_json<response, registry>(r, response_text);
+
+        std::vector<char> foo_text;
+        write_json<foo, registry>(f, foo_text);
+
+        std::string sample_text;
+        write_json<sample, registry>(s, sample_text);
+
+        succeeded = response_text == "prefix:" + to_json<response, registry>(r) &&
+                    std::string(foo_text.begin(), foo_text.end()) == to_json<foo, registry>(f) &&
+                    sample_text == to_json<sample, registry>(s);
+    }
+    catch(std::exception const& e)
+    {
+        std::cout << e.what() << std::endl;
+    }
+
+    ASSERT_TRUE(succeeded);
+}
+
+TEST(JsonSerialization, NativeReaderMatchesDom)
+{
+    bool succeeded = false;
+    try
+    {
+        std::string const response_json = "{"
+                                          "\"success\":true, "
+                                          "\"unknown\": {\"nested\": [1, 2.5e3, \"x\", null, false]}, "
+                                          "\"data\":"
+                                          "  ["
+                                          "      {"
+                                          "          \"1\":"
+                                          "              {"
+                                          "                  \"token\":\"h\\u00e9y \\ud83d\\ude00 \\\"quoted\\\"\""
+                                          "              }"
+                                          "      },"
+                                          "      {"
+                                          "          \"2\":"
+                                          "              {"
+                                          "                  \"token\":\"\""
+                                          "              }"
+                                          "      }"
+                                          "  ]"
+                                          "}";
+
+        std::string const foo_json = "{ \"f\": [ { \"bbbbbbbbbb\": [ { \"token\": \"hey1\" }, { \"token\": \"hey2\" } ] },"
+                                     "           { \"cccccccccc\": null } ] }";
+
+        sample s{._id = -42,
+                 ._big = 9007199254740993,
+                 ._ratio = 0.1,
+                 ._scale = 1e21,
+                 ._flag = 'x',
+                 ._text = "line\nbreak",
+                 ._triple = {1, 2, 3},
+                 ._values = {1.0, -0.0, 123456.789},
+                 ._maybe = 2.5};
+        std::string const sample_json = to_json<sample, registry>(s);
+
+        auto const r1 = from_json<response, registry>(response_json);
+        auto const r2 = read_json<response, registry>(response_json);
+        auto const f1 = from_json<foo, registry>(foo_json);
+        auto const f2 = read_json<foo, registry>(foo_json);
+        auto const s2 = read_json<sample, registry>(sample_json);
+
+        succeeded = r1._success == r2._success &&
+                    r1._data == r2._data &&
+                    r2._data->at("1")._token == "h\xc3\xa9y \xf0\x9f\x98\x80 \"quoted\"" &&
+                    f1 == f2 &&
+                    to_json<sample, registry>(s2) == sample_json;
+    }
+    catch(std::exception const& e)
+    {
+        std::cout << e.what() << std::endl;
+    }
+
+    ASSERT_TRUE(succeeded);
+}
+
+TEST(JsonSerialization, NativeReaderErrors)
+{
+    EXPECT_THROW((read_json<response, registry>("{\"success\":true, \"data\":[")), nlohmann::json::parse_error);
+    EXPECT_THROW((read_json<response, registry>("{\"success\":tru, \"data\":null}")), nlohmann::json::parse_error);
+    EXPECT_THROW((read_json<response, registry>("{\"success\":true, \"data\":null} x")), nlohmann::json::parse_error);
+    EXPECT_THROW((read_json<response, registry>("{\"success\":true}")), nlohmann::json::out_of_range);
+    EXPECT_THROW((read_json<response, registry>("{\"success\":\"yes\", \"data\":null}")), nlohmann::json::type_error);
+    EXPECT_THROW((read_json<response, registry>("[]")), nlohmann::json::type_error);
+}
+
+TEST(JsonSerialization, NativeReaderDepthLimit)
+{
+    auto const nested = [](std::size_t const depth) {
+        return "{\"success\":true, \"data\":null, \"unknown\":" + std::string(depth, '[') + std::string(depth, ']') + "}";
+    };
+
+    EXPECT_TRUE((read_json<response, registry>(nested(dori::json::reader::max_depth - 1))._success));
+
+    auto const deep = try_from_json<response, registry>(nested(200000));
+    ASSERT_FALSE(deep.has_value());
+    EXPECT_EQ(deep.error().kind, dori::json::error_kind::too_deep);
+    EXPECT_EQ(deep.error().offset, 40 + dori::json::reader::max_depth - 1);
+    EXPECT_THROW((read_json<response, registry>(nested(200000))), nlohmann::json::parse_error);
+
+    std::string const lazy = "{\"data\":" + std::string(200000, '[') + std::string(200000, ']') + ",\"route\":\"\"}";
+    EXPECT_THROW((read_json<routed, registry>(lazy)), nlohmann::json::parse_error);
+}
+
+TEST(JsonSerialization, ExpectedErrors)
+{
+    auto const decoded = try_from_json<response, registry>("{\"success\":true, \"data\":[{\"1\":{\"token\":\"hey\"}}]}");
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(decoded->_data->at("1")._token, "hey");
+
+    std::string const mismatch = "{\"success\":true, \"data\":[{\"1\":{\"token\":\"a\"}}, {\"a/b~\":{\"token\":7}}]}";
+    auto const failed = try_from_json<response, registry>(mismatch);
+    ASSERT_FALSE(failed.has_value());
+    EXPECT_EQ(failed.error().kind, dori::json::error_kind::type_mismatch);
+    EXPECT_EQ(failed.error().offset, mismatch.find('7'));
+    EXPECT_EQ(failed.error().path, "/data/1/a~1b~0/token");
+
+    std::string const escaped = "{\"success\":true, \"data\":{\"an escaped \\u006bey that outgrows short strings\":"
+                                "{\"tok\\u0065n\":\"a malformed value string that outgrows short strings \\q\"}}}";
+    auto const malformed = try_from_json<response, registry>(escaped);
+    ASSERT_FALSE(malformed.has_value());
+    EXPECT_EQ(malformed.error().path, "/data/an escaped key that outgrows short strings/token");
+    EXPECT_THROW((read_json<response, registry>(escaped)), nlohmann::json::parse_error);
+
+    auto const missing = try_from_json<foo, registry>("{\"f\":[{\"k\":[{\"token\":\"a\"}, {}]}]}");
+    ASSERT_FALSE(missing.has_value());
+    EXPECT_EQ(missing.error().kind, dori::json::error_kind::missing_field);
+    EXPECT_EQ(missing.error().path, "/f/0/k/1/token");
+
+    auto const truncated = try_from_json<sample, registry>("{\"id\":1, \"triple\":[1, 2");
+    ASSERT_FALSE(truncated.has_value());
+    EXPECT_EQ(truncated.error().kind, dori::json::error_kind::unexpected_end);
+    EXPECT_EQ(truncated.error().path, "/triple");
+
+    auto const trailing = try_from_json<data, registry>("{\"token\":\"x\"} x");
+    ASSERT_FALSE(trailing.has_value());
+    EXPECT_EQ(trailing.error().kind, dori::json::error_kind::unexpected_character);
+    EXPECT_EQ(trailing.error().offset, 14u);
+    EXPECT_TRUE(trailing.error().path.empty());
+}
+
+TEST(JsonSerialization, FieldIndexLookup)
+{
+    using index = dori::meta::field_index<sample, registry>;
+    constexpr auto const& names = dori::meta::field_names<sample, registry>;
+
+    static_assert(index::find("values") == 7);
+    static_assert(index::find("value") == index::npos);
+
+    for(std::size_t i = 0; i < names.size(); ++i)
+    {
+        EXPECT_EQ(index::find(names[i]), i);
+        EXPECT_EQ(index::find(names[i], i), i);
+        EXPECT_EQ(index::find(names[i], (i + 1) % names.size()), i);
+    }
+    EXPECT_EQ(index::find(""), index::npos);
+    EXPECT_EQ(index::find("tokens", 0), index::npos);
+
+    // sample is not declared in key order: the expected-next guess must follow the written order to hit
+    std::string written;
+    write_json<sample, registry>(sample{}, written);
+    dori::json::reader keys(written);
+    std::size_t expected = dori::meta::first_field<sample, registry>;
+    std::size_t hits = 0;
+    ASSERT_TRUE(keys.read_object([&](std::string_view const key) {
+        hits += names[expected] == key;
+        expected = dori::meta::next_field<sample, registry>[index::find(key, expected)];
+        return keys.skip_value();
+    }));
+    EXPECT_EQ(hits, names.size());
+    EXPECT_EQ(expected, names.size());
+
+    std::string const shuffled = "{\"maybe\":null,\"values\":[],\"zzz\":1,\"triple\":[3,2,1],\"text\":\"t\","
+                                 "\"id\":7,\"flag\":65,\"scale\":2.0,\"ratio\":0.5,\"big\":-1}";
+    auto const from_dom = from_json<sample, registry>(shuffled);
+    auto const from_native = read_json<sample, registry>(shuffled);
+
+    EXPECT_EQ(from_dom._id, 7);
+    EXPECT_EQ(from_native._id, 7);
+    EXPECT_TRUE((from_native._triple == std::array<int, 3>{3, 2, 1}));
+    EXPECT_EQ((to_json<sample, registry>(from_dom)), (to_json<sample, registry>(from_native)));
+}
+
+TEST(JsonSerialization, KeyFragments)
+{
+    using response_keys = dori::json::key_fragments<response, registry>;
+    using sample_keys = dori::json::key_fragments<sample, registry>;
+
+    static_assert(response_keys::size == 2);
+    static_assert(response_keys::get(0) == "{\"data\":");
+    static_assert(response_keys::get(1) == ",\"success\":");
+
+    static_assert(sample_keys::size == 9);
+    static_assert(sample_keys::get(0) == "{\"big\":");
+    static_assert(sample_keys::get(8) == ",\"values\":");
+
+    response r;
+    r._success = false;
+    r._data = std::nullopt;
+
+    std::string text;
+    write_json<response, registry>(r, text);
+    EXPECT_EQ(text, "{\"data\":null,\"success\":false}");
+}
+
+TEST(JsonKernels, SimdMatchesScalar)
+{
+    using namespace dori::json::kernels;
+
+    std::mt19937 random(42);
+    std::string const alphabet = "abcdefgh  \t\n\r\"\\\x01\x1f\x7f\xc3\xa9";
+    std::string text(300, ' ');
+
+    for(int round = 0; round < 200; ++round)
+    {
+        // mostly plain or mostly blank buffers, with a few special characters
+        char const filler = round % 2 == 0 ? 'x' : ' ';
+        for(auto& c : text)
+        {
+            c = random() % 8 == 0 ? alphabet[random() % alphabet.size()] : filler;
+        }
+
+        char const* const end = text.data() + text.size();
+        for(auto level = static_cast<int>(isa::scalar); level <= static_cast<int>(detect_isa()); ++level)
+        {
+            auto const set = kernels_for(static_cast<isa>(level));
+            for(std::size_t offset = 0; offset < 64; ++offset)
+            {
+                char const* const begin = text.data() + offset;
+                ASSERT_EQ(set.find_escape(begin, end), scalar::find_escape(begin, end));
+                ASSERT_EQ(set.skip_whitespace(begin, end), scalar::skip_whitespace(begin, end));
+            }
+        }
+    }
+}
+
+TEST(JsonSerialization, WidthCorrectNumbers)
+{
+    numbers const n{._i8 = -128,
+                    ._u8 = 255,
+                    ._i16 = -32768,
+                    ._i32 = 2147483647,
+                    ._i64 = std::numeric_limits<std::int64_t>::min(),
+                    ._u64 = std::numeric_limits<std::uint64_t>::max(),
+                    ._f32 = 0.1f,
+                    ._f64 = 0.1};
+
+    std::string text;
+    write_json<numbers, registry>(n, text);
+    EXPECT_EQ(text, "{\"f32\":0.1,\"f64\":0.1,\"i16\":-32768,\"i32\":2147483647,\"i64\":-9223372036854775808,"
+                    "\"i8\":-128,\"u64\":18446744073709551615,\"u8\":255}");
+
+    for(auto const& decoded : {read_json<numbers, registry>(text), from_json<numbers, registry>(text)})
+    {
+        EXPECT_EQ(decoded._i8, n._i8);
+        EXPECT_EQ(decoded._u8, n._u8);
+        EXPECT_EQ(decoded._i16, n._i16);
+        EXPECT_EQ(decoded._i32, n._i32);
+        EXPECT_EQ(decoded._i64, n._i64);
+        EXPECT_EQ(decoded._u64, n._u64);
+        EXPECT_EQ(decoded._f32, n._f32);
+        EXPECT_EQ(decoded._f64, n._f64);
+    }
+
+    std::string const integral_float = "{\"f32\":1,\"f64\":2,\"i16\":1e3,\"i32\":-4.0,\"i64\":0,\"i8\":0,\"u64\":0,\"u8\":0}";
+    EXPECT_EQ((read_json<numbers, registry>(integral_float)._i16), 1000);
+    EXPECT_EQ((from_json<numbers, registry>(integral_float)._i32), -4);
+
+    std::string const overflow = "{\"f32\":1,\"f64\":2,\"i16\":0,\"i32\":0,\"i64\":0,\"i8\":128,\"u64\":0,\"u8\":0}";
+    EXPECT_THROW((read_json<numbers, registry>(overflow)), nlohmann::json::out_of_range);
+    EXPECT_THROW((from_json<numbers, registry>(overflow)), nlohmann::json::out_of_range);
+
+    std::string const negative_unsigned = "{\"f32\":1,\"f64\":2,\"i16\":0,\"i32\":0,\"i64\":0,\"i8\":0,\"u64\":-1,\"u8\":0}";
+    EXPECT_THROW((read_json<numbers, registry>(negative_unsigned)), nlohmann::json::out_of_range);
+    EXPECT_THROW((from_json<numbers, registry>(negative_unsigned)), nlohmann::json::out_of_range);
+
+    std::string const fraction = "{\"f32\":1,\"f64\":2,\"i16\":0,\"i32\":1.5,\"i64\":0,\"i8\":0,\"u64\":0,\"u8\":0}";
+    EXPECT_THROW((read_json<numbers, registry>(fraction)), nlohmann::json::type_error);
+    EXPECT_THROW((from_json<numbers, registry>(fraction)), nlohmann::json::type_error);
+
+    std::string const float_overflow = "{\"f32\":1e39,\"f64\":1e-400,\"i16\":0,\"i32\":0,\"i64\":0,\"i8\":0,\"u64\":0,\"u8\":0}";
+    EXPECT_THROW((read_json<numbers, registry>(float_overflow)), nlohmann::json::out_of_range);
+}
+
+TEST(JsonSerialization, ArenaDecoding)
+{
+    std::string const json = "{ \"f\": [ { \"a key long enough to leave the small string buffer\": "
+                             "[ { \"token\": \"a token long enough to leave the small string buffer\" }, { \"token\": \"h\\u00e9y\" } ] },"
+                             "           { \"b\": null } ] }";
+
+    std::array<std::byte, 4096> buffer;
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+
+    auto const decoded = from_json<pmr_foo, registry>(json, &arena);
+
+    ASSERT_EQ(decoded._f.size(), 2u);
+    EXPECT_EQ(decoded._f.get_allocator().resource(), &arena);
+
+    auto const& [key, tokens] = *decoded._f.begin();
+    EXPECT_EQ(key.get_allocator().resource(), &arena);
+    ASSERT_TRUE(tokens.has_value());
+    ASSERT_EQ(tokens->size(), 2u);
+    EXPECT_EQ(tokens->get_allocator().resource(), &arena);
+    EXPECT_EQ((*tokens)[0]._token.get_allocator().resource(), &arena);
+    EXPECT_EQ((*tokens)[1]._token, "h\xc3\xa9y");
+    EXPECT_FALSE(decoded._f.at("b").has_value());
+
+    EXPECT_EQ((to_json<pmr_foo, registry>(decoded)), (to_json<foo, registry>(from_json<foo, registry>(json))));
+    EXPECT_EQ((from_json<pmr_foo, registry>(to_json<pmr_foo, registry>(decoded))), decoded);
+}
+
+template<typename T, typename Input>
+concept read_json_accepts = requires(Input&& input) { read_json<T, registry>(std::forward<Input>(input)); };
+
+template<typename T, typename Input>
+concept try_from_json_accepts = requires(Input&& input) { try_from_json<T, registry>(std::forward<Input>(input)); };
+
+TEST(JsonSerialization, BorrowedStrings)
+{
+    // the decoded value would view a temporary input
+    static_assert(!read_json_accepts<view_data, std::string>);
+    static_assert(!read_json_accepts<routed, std::string>);
+    static_assert(!try_from_json_accepts<view_data, std::string>);
+    static_assert(read_json_accepts<view_data, std::string&>);
+    static_assert(read_json_accepts<view_data, char const (&)[3]>);
+    static_assert(read_json_accepts<data, std::string>);
+    static_assert(dori::json::borrows_input_v<std::optional<std::map<std::string, std::vector<view_data>>>, registry>);
+    static_assert(!dori::json::borrows_input_v<response, registry>);
+
+    std::string const json = "{\"note\":\"tab\\there\",\"owned\":\"copy\",\"raw\":\"raw bytes\",\"token\":\"plain token\"}";
+    auto const in_input = [&](char const* p) {
+        return p >= json.data() && p < json.data() + json.size();
+    };
+
+    std::pmr::monotonic_buffer_resource arena;
+    auto const decoded = from_json_borrowed<view_data, registry>(json, &arena);
+
+    EXPECT_EQ(decoded._token, "plain token");
+    EXPECT_TRUE(in_input(decoded._token.data()));
+    EXPECT_EQ(std::string_view(decoded._raw.data(), decoded._raw.size()), "raw bytes");
+    EXPECT_TRUE(in_input(decoded._raw.data()));
+    ASSERT_TRUE(decoded._note.has_value());
+    EXPECT_EQ(*decoded._note, "tab\there");
+    EXPECT_FALSE(in_input(decoded._note->data()));
+    EXPECT_EQ(decoded._owned, "copy");
+
+    EXPECT_EQ((to_json<view_data, registry>(decoded)), json);
+    std::string written;
+    write_json<view_data, registry>(decoded, written);
+    EXPECT_EQ(written, json);
+
+    EXPECT_THROW((from_json_borrowed<view_data, registry>(json)), nlohmann::json::type_error);
+    std::string_view const without_escape_json = "{\"token\":\"a\",\"raw\":\"\",\"note\":null,\"owned\":\"b\"}";
+    auto const without_escape = from_json_borrowed<view_data, registry>(without_escape_json);
+    EXPECT_EQ(without_escape._token, "a");
+    EXPECT_TRUE(without_escape._raw.empty());
+    EXPECT_FALSE(without_escape._note.has_value());
+}
+
+TEST(JsonSerialization, LazyMember)
+{
+    std::string const payload = "[ {\"1\": {\"token\": \"a ] } \\\" b\"}}, {\"2\": {\"token\": \"\"}} ]";
+    std::string const json = "{\"data\":" + payload + ",\"route\":\"users\"}";
+
+    auto decoded = read_json<routed, registry>(json);
+    EXPECT_EQ(decoded._route, "users");
+    EXPECT_FALSE(decoded._data.is_decoded());
+    EXPECT_EQ(decoded._data.raw(), payload);
+
+    std::string written;
+    write_json<routed, registry>(decoded, written);
+    EXPECT_EQ(written, json);
+    EXPECT_EQ((to_json<routed, registry>(decoded)), nlohmann::json::parse(json).dump());
+
+    auto const& view = decoded;
+    ASSERT_TRUE(view._data->has_value());
+    EXPECT_EQ((*view._data)->at("1")._token, "a ] } \" b");
+    EXPECT_TRUE(decoded._data.is_raw());
+
+    decoded._data.get()->at("2")._token = "changed";
+    EXPECT_FALSE(decoded._data.is_raw());
+    written.clear();
+    write_json<routed, registry>(decoded, written);
+    EXPECT_EQ(written, "{\"data\":[{\"1\":{\"token\":\"a ] } \\\" b\"}},{\"2\":{\"token\":\"changed\"}}],\"route\":\"users\"}");
+    EXPECT_EQ((to_json<routed, registry>(decoded)), written);
+    EXPECT_EQ((from_json<routed, registry>(written)._data->value().at("2")._token), "changed");
+
+    auto const malformed = read_json<routed, registry>("{\"data\":[{\"1\":{\"token\":x}}],\"route\":\"\"}");
+    EXPECT_THROW(malformed._data.get(), nlohmann::json::parse_error);
+    EXPECT_THROW((read_json<routed, registry>("{\"data\":[{\"1\":{\"token\":\"x\"]}],\"route\":\"\"}")), nlohmann::json::parse_error);
+    EXPECT_THROW((read_json<routed, registry>("{\"data\":[1},\"route\":\"\"}")), nlohmann::json::parse_error);
+    EXPECT_THROW((read_json<routed, registry>("{\"data\":[{\"1\":{\"token\":\"x\"}}")), nlohmann::json::parse_error);
+}
+
+TEST(JsonStreaming, RecordsRoundTrip)
+{
+    std::vector<sample> records;
+    for(int i = 0; i < 500; ++i)
+    {
+        records.push_back(sample{._id = i,
+                                 ._big = i * 1000003ll,
+                                 ._ratio = i / 7.0,
+                                 ._scale = 1e21,
+                                 ._flag = 'x',
+                                 ._text = "record [" + std::to_string(i) + "] {\"quoted\"}\n",
+                                 ._triple = {i, -i, 0},
+                                 ._values = std::vector<double>(static_cast<std::size_t>(i % 5), 0.5),
+                                 ._maybe = i % 2 == 0 ? std::optional<double>(i) : std::nullopt});
+    }
+
+    for(auto const format : {dori::json::stream_format::ndjson, dori::json::stream_format::array})
+    {
+        std::stringstream stream;
+        write_json_records<sample, registry>(records, stream, format);
+        if(format == dori::json::stream_format::array)
+        {
+            EXPECT_EQ(nlohmann::json::parse(stream.str()).size(), records.size());
+        }
+
+        // a tiny chunk size forces records to straddle refills
+        dori::json::record_reader<sample, registry, dori::json::istream_source> reader(dori::json::istream_source(stream), format, 7);
+        std::size_t i = 0;
+        for(auto const& record : reader)
+        {
+            ASSERT_LT(i, records.size());
+            EXPECT_EQ((to_json<sample, registry>(record)), (to_json<sample, registry>(records[i])));
+            ++i;
+        }
+        EXPECT_EQ(i, records.size());
+    }
+
+    std::stringstream empty;
+    write_json_records<sample, registry>(std::vector<sample>{}, empty, dori::json::stream_format::array);
+    EXPECT_EQ(empty.str(), "[]");
+    std::size_t count = 0;
+    for(auto const& record : read_json_records<sample, registry>(empty, dori::json::stream_format::array))
+    {
+        (void)record;
+        ++count;
+    }
+    EXPECT_EQ(count, 0u);
+
+    // finishing again, explicitly or from the destructor, does not close the array twice
+    std::stringstream closed;
+    {
+        dori::json::record_writer<data, registry, dori::json::ostream_sink> writer(dori::json::ostream_sink(closed), dori::json::stream_format::array);
+        writer.write(data{"a"});
+        writer.finish();
+        writer.finish();
+    }
+    EXPECT_EQ(closed.str(), "[{\"token\":\"a\"}]");
+
+    std::stringstream blank_lines("\n{\"token\":\"a\"}\r\n\n  \n{\"token\":\"b\"}");
+    std::string tokens;
+    for(auto const& record : read_json_records<data, registry>(blank_lines))
+    {
+        tokens += record._token;
+    }
+    EXPECT_EQ(tokens, "ab");
+
+    std::stringstream truncated("[{\"token\":\"a\"},{\"token\":");
+    auto reader = read_json_records<data, registry>(truncated, dori::json::stream_format::array);
+    data record;
+    EXPECT_TRUE(reader.next(record));
+    EXPECT_THROW(reader.next(record), nlohmann::json::parse_error);
+
+#if defined(DORI_JSON_HAS_FD)
+    std::FILE* const file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    write_json_records<sample, registry>(records, fileno(file), dori::json::stream_format::ndjson);
+    std::rewind(file);
+    std::size_t from_fd = 0;
+    for(auto const& r : read_json_records<sample, registry>(fileno(file)))
+    {
+        EXPECT_EQ(r._id, records[from_fd++]._id);
+    }
+    EXPECT_EQ(from_fd, records.size());
+    std::fclose(file);
+#endif
+}
+
+TEST(JsonParallel, DecodeMatchesSequential)
+{
+    std::vector<sample> records;
+    for(int i = 0; i < 2000; ++i)
+    {
+        records.push_back(sample{._id = i,
+                                 ._big = -i,
+                                 ._ratio = i * 0.25,
+                                 ._scale = 2.0,
+                                 ._flag = 'p',
+                                 ._text = "line " + std::to_string(i),
+                                 ._triple = {i, i, i},
+                                 ._values = {1.5},
+                                 ._maybe = std::nullopt});
+    }
+
+    dori::json::thread_pool pool(4);
+    for(auto const format : {dori::json::stream_format::ndjson, dori::json::stream_format::array})
+    {
+        std::stringstream stream;
+        write_json_records<sample, registry>(records, stream, format);
+
+        auto const decoded = read_json_parallel<sample, registry>(stream.str(), pool, format);
+        ASSERT_EQ(decoded.size(), records.size());
+        for(std::size_t i = 0; i < records.size(); ++i)
+        {
+            EXPECT_EQ(decoded[i]._id, records[i]._id);
+            EXPECT_EQ(decoded[i]._text, records[i]._text);
+        }
+    }
+
+    EXPECT_EQ((read_json_parallel<data, registry>("", dori::json::stream_format::ndjson, 3).size()), 0u);
+    EXPECT_EQ((read_json_parallel<data, registry>(" [ ] ", dori::json::stream_format::array, 3).size()), 0u);
+
+    std::string lines;
+    for(int i = 0; i < 100; ++i)
+    {
+        lines += i == 10 ? "{\"token\":1}\n" : i == 90 ? "{\"token\":\n" : "{\"token\":\"x\"}\n";
+    }
+    EXPECT_THROW((read_json_parallel<data, registry>(lines, pool)), nlohmann::json::type_error);
+    EXPECT_THROW((read_json_parallel<data, registry>("[{\"token\":\"x\"},", pool, dori::json::stream_format::array)), nlohmann::json::parse_error);
+}
+
+TEST(JsonParallel, EncodeMatchesSequential)
+{
+    std::vector<sample> records;
+    for(int i = 0; i < 3000; ++i)
+    {
+        records.push_back(sample{._id = i,
+                                 ._big = i * 31ll,
+                                 ._ratio = 1.0 / (i + 1),
+                                 ._scale = -3.5,
+                                 ._flag = 'e',
+                                 ._text = "item \"" + std::to_string(i) + "\"",
+                                 ._triple = {0, 1, i},
+                                 ._values = {},
+                                 ._maybe = i % 3 == 0 ? std::optional<double>(0.1) : std::nullopt});
+    }
+
+    std::string sequential;
+    dori::json::writer<std::string> writer(sequential);
+    write_json_value<std::vector<sample>, registry>(writer, records);
+
+    dori::json::thread_pool pool(4);
+    for(std::size_t const threshold : {std::size_t{100}, std::size_t{1000000}})
+    {
+        std::string parallel;
+        write_json_parallel<sample, registry>(records, parallel, pool, threshold);
+        EXPECT_EQ(parallel, sequential);
+    }
+
+    std::string empty;
+    write_json_parallel<sample, registry>(std::span<sample const>(), empty, pool, 0);
+    EXPECT_EQ(empty, "[]");
+
+    // the options reach every chunk, so float digits and column encodings match the sequential writer
+    std::vector<numbers> floats;
+    for(int i = 0; i < 300; ++i)
+    {
+        floats.push_back(numbers{-1, 2, -3, i, -5, 6, 0.1f * static_cast<float>(i), 0.5});
+    }
+    for(auto const options : {dori::json::write_options{.format = dori::json::text_format::dom},
+                              dori::json::write_options{.arrays = dori::json::array_encoding::columns}})
+    {
+        std::string expected;
+        dori::json::writer<std::string> options_writer(expected, options);
+        write_json_value<std::vector<numbers>, registry>(options_writer, floats);
+
+        std::string parallel;
+        write_json_parallel<numbers, registry>(floats, parallel, pool, 100, options);
+        EXPECT_EQ(parallel, expected);
+    }
+
+#if defined(DORI_JSON_HAS_WRITEV)
+    std::FILE* const file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    write_json_parallel<sample, registry>(records, fileno(file), pool, 100);
+    std::rewind(file);
+    std::string from_fd(sequential.size() + 1, '\0');
+    from_fd.resize(std::fread(from_fd.data(), 1, from_fd.size(), file));
+    std::fclose(file);
+    EXPECT_EQ(from_fd, sequential);
+#endif
+}
+
+namespace
+{
+    template<typename T>
+    auto push_decode(std::string_view const json, std::size_t const chunk_size) -> T {
+        dori::json::push_decoder<T, registry> decoder;
+        for(std::size_t i = 0; i < json.size(); i += chunk_size)
+        {
+            decoder.feed(json.substr(i, chunk_size));
+        }
+        return decoder.finish();
+    }
+}
+
+TEST(JsonPushDecoder, ByteByByteMatchesReader)
+{
+    std::string const response_json = "{"
+                                      "\"success\":true, "
+                                      "\"unknown\": {\"nested\": [1, 2.5e3, \"x}\", null, false]}, "
+                                      "\"data\":"
+                                      "  ["
+                                      "      { \"1\": { \"token\":\"h\\u00e9y \\\"quoted\\\"\" } },"
+                                      "      { \"2\": { \"token\":\"\" } }"
+                                      "  ]"
+                                      "} ";
+    std::string const foo_json = "{ \"f\": [ { \"bbbbbbbbbb\": [ { \"token\": \"hey1\" }, { \"token\": \"hey2\" } ] },"
+                                 "           { \"cccccccccc\": null } ] }";
+    std::string const sample_json = to_json<sample, registry>(sample{._id = 7,
+                                                                     ._big = -9007199254740993,
+                                                                     ._ratio = 0.1,
+                                                                     ._scale = 1e-7,
+                                                                     ._flag = 'q',
+                                                                     ._text = "tab\there",
+                                                                     ._triple = {3, 2, 1},
+                                                                     ._values = {1.0, 2.0},
+                                                                     ._maybe = std::nullopt});
+
+    for(std::size_t const chunk_size : {std::size_t{1}, std::size_t{3}, std::size_t{64}})
+    {
+        auto const r = push_decode<response>(response_json, chunk_size);
+        auto const expected = read_json<response, registry>(response_json);
+        EXPECT_EQ(r._success, expected._success);
+        EXPECT_EQ(r._data, expected._data);
+        EXPECT_EQ(push_decode<foo>(foo_json, chunk_size), (read_json<foo, registry>(foo_json)));
+        EXPECT_EQ((to_json<sample, registry>(push_decode<sample>(sample_json, chunk_size))), sample_json);
+    }
+
+    dori::json::push_decoder<data, registry> decoder;
+    EXPECT_FALSE(decoder.feed(std::string_view("{\"tok")));
+    EXPECT_THROW(decoder.finish(), nlohmann::json::parse_error);
+    EXPECT_TRUE(decoder.feed(std::string_view("en\": \"x\"}")));
+    EXPECT_EQ(decoder.finish()._token, "x");
+    EXPECT_TRUE(decoder.feed(std::string_view("  \n")));
+    EXPECT_THROW(decoder.feed(std::string_view("x")), nlohmann::json::parse_error);
+
+    EXPECT_THROW(push_decode<response>("{\"success\":true}", 1), nlohmann::json::out_of_range);
+    EXPECT_THROW(push_decode<response>("{\"success\":\"yes\",\"data\":null}", 1), nlohmann::json::type_error);
+    EXPECT_THROW(push_decode<response>("{\"success\":true \"data\":null}", 1), nlohmann::json::parse_error);
+}
+
+TEST(JsonPushDecoder, StreamsNestedValues)
+{
+    foo f;
+    for(int i = 0; i < 2000; ++i)
+    {
+        f._f["key " + std::to_string(i)] = i % 7 == 0 ? std::nullopt : std::optional<std::vector<data>>({data{std::string(static_cast<std::size_t>(i % 20), 'z')}, data{"b"}});
+    }
+    std::string const text = to_json<foo, registry>(f);
+
+    // only the unfinished token is held between chunks, not the member around it
+    constexpr std::size_t chunk_size = 7;
+    dori::json::push_decoder<foo, registry> decoder;
+    std::size_t peak = 0;
+    for(std::size_t i = 0; i < text.size(); i += chunk_size)
+    {
+        decoder.feed(std::string_view(text).substr(i, chunk_size));
+        peak = std::max(peak, decoder.buffered());
+    }
+    EXPECT_LT(peak, 32u);
+    EXPECT_EQ(decoder.finish(), f);
+
+    tape const t{._ticks = {tick{._seq = 1, ._head = {"a"}, ._tail = data{"t"}, ._values = {1, 2}},
+                            tick{._seq = 2, ._head = {"b"}, ._tail = std::nullopt, ._values = {}}}};
+    catalog const c{._stock = {{"apple", 3}}, ._by_id = {{-2, {"b"}}, {10, {"a"}}}, ._flat = {{"y", 2}, {"x\n", 1}}};
+    for(std::size_t const size : {std::size_t{1}, std::size_t{5}})
+    {
+        for(auto const& options : {dori::json::write_options{}, dori::json::write_options{.arrays = dori::json::array_encoding::columns}})
+        {
+            EXPECT_EQ((to_json<tape, registry>(push_decode<tape>(to_json<tape, registry>(t, options), size))), (to_json<tape, registry>(t)));
+        }
+        for(auto const& options : {dori::json::write_options{}, dori::json::write_options{.maps = dori::json::map_encoding::object}})
+        {
+            auto const text = to_json<catalog, registry>(c, options);
+            EXPECT_EQ((to_json<catalog, registry>(push_decode<catalog>(text, size))), (to_json<catalog, registry>(read_json<catalog, registry>(text))));
+        }
+    }
+}
+
+TEST(JsonPushDecoder, ReportsOffsetsOfTheWholeInput)
+{
+    auto const message = [](auto&& decode) {
+        try
+        {
+            decode();
+        }
+        catch(nlohmann::json::exception const& e)
+        {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+
+    for(std::string const json : {"{\"success\":true, \"data\":{\"1\":{\"token\":7}}}",
+                                  "{\"success\":true, \"data\":{\"1\":{\"token\":\"bad \\q\"}}}",
+                                  "{\"success\":true, \"data\":{\"1\":{\"token\":\"a\"}, \"2\":[]}}",
+                                  "{\"success\":tru, \"data\":null}"})
+    {
+        auto const expected = message([&] { return read_json<response, registry>(json); });
+        ASSERT_FALSE(expected.empty());
+        EXPECT_EQ(message([&] { return push_decode<response>(json, 3); }), expected);
+    }
+
+    std::string const deep = "{\"token\":\"a\", \"deep\":" + std::string(dori::json::reader::max_depth + 1, '[');
+    dori::json::push_decoder<data, registry> decoder;
+    EXPECT_THROW(decoder.feed(std::string_view(deep)), nlohmann::json::parse_error);
+    EXPECT_THROW(decoder.feed(std::string_view("]")), nlohmann::json::parse_error);
+}
+
+/**
+ * @brief A temporary file path of the running test and process, so parallel test runs do not share it
+ */
+auto unique_temp_path() -> std::filesystem::path {
+    auto const* const test = ::testing::UnitTest::GetInstance()->current_test_info();
+    return std::filesystem::temp_directory_path() / ("dori_" + std::string(test->test_suite_name()) + "_" + test->name() + "_" + std::to_string(::getpid()) + ".json");
+}
+
+TEST(JsonFile, WriteThenMapRoundTrip)
+{
+    auto const path = unique_temp_path();
+
+    foo f;
+    for(int i = 0; i < 8000; ++i)
+    {
+        f._f["key " + std::to_string(i)] = i % 5 == 0 ? std::nullopt : std::optional<std::vector<data>>({data{std::string(static_cast<std::size_t>(i % 300), 'z')}});
+    }
+
+    to_json_file<foo, registry>(f, path);
+    std::ifstream in(path, std::ios::binary);
+    std::string const content{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    EXPECT_EQ(content, (to_json<foo, registry>(f)));
+    EXPECT_GT(content.size(), dori::json::default_file_block_size);
+
+    EXPECT_EQ((from_json_file<foo, registry>(path)), f);
+
+    std::string blocks;
+    struct string_sink
+    {
+        std::string& out;
+        auto write(std::string_view const data) -> void {
+            out.append(data);
+        }
+    } sink{blocks};
+    dori::json::block_buffer buffer(sink, 7);
+    write_json<foo, registry>(f, buffer);
+    buffer.flush();
+    EXPECT_EQ(blocks, content);
+
+    std::filesystem::remove(path);
+    EXPECT_THROW((from_json_file<foo, registry>(path)), std::system_error);
+}
+
+TEST(JsonFile, BorrowedMembersKeepTheMapping)
+{
+    auto const path = unique_temp_path();
+
+    view_data const source{._token = "plain token", ._raw = std::span<char const>("raw bytes", 9), ._note = "tab\there", ._owned = "copy"};
+    to_json_file<view_data, registry>(source, path);
+
+    auto document = from_json_file_borrowed<view_data, registry>(path);
+    auto const moved = std::move(document);
+    std::filesystem::remove(path);
+
+    EXPECT_EQ(moved->_token, "plain token");
+    EXPECT_EQ(std::string_view(moved->_raw.data(), moved->_raw.size()), "raw bytes");
+    EXPECT_EQ(moved->_note, "tab\there");
+    EXPECT_EQ(moved->_owned, "copy");
+
+    std::string const payload = "[{\"1\":{\"token\":\"mapped\"}}]";
+    std::ofstream(path, std::ios::binary) << "{\"data\":" << payload << ",\"route\":\"r\"}";
+    auto routed_document = from_json_file_borrowed<routed, registry>(path);
+    std::filesystem::remove(path);
+    EXPECT_EQ(routed_document->_data.raw(), payload);
+    EXPECT_EQ((*routed_document)._data->value().at("1")._token, "mapped");
+}
+
+TEST(JsonFile, MatchesToJsonText)
+{
+    auto const path = unique_temp_path();
+
+    // floats are written with the digits of to_json, not the shorter ones of write_json
+    numbers const n{-1, 2, -3, 4, -5, 6, 0.1f, 0.2};
+    to_json_file<numbers, registry>(n, path);
+    std::ifstream in(path, std::ios::binary);
+    std::string const content{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    in.close();
+    std::filesystem::remove(path);
+
+    EXPECT_EQ(content, (to_json<numbers, registry>(n)));
+    EXPECT_NE(content.find("0.10000000149011612"), std::string::npos);
+}
+
+TEST(JsonProjection, DecodesOnlySelectedMembers)
+{
+    std::string const json = "{"
+                             "\"unknown\": {\"nested\": [1, \"x}\", null]}, "
+                             "\"data\": [ { \"1\": { \"token\": \"hey\", \"extra\": [true, {\"k\": false}] } } ], "
+                             "\"success\": true"
+                             "}";
+
+    auto const success = from_json<response, registry>(json, dori::json::fields<"success">);
+    EXPECT_TRUE(success._success);
+    EXPECT_FALSE(success._data.has_value());
+
+    auto const token = from_json<response, registry>(json, dori::json::fields<"data.token">);
+    EXPECT_FALSE(token._success);
+    ASSERT_TRUE(token._data.has_value());
+    EXPECT_EQ(token._data->at("1")._token, "hey");
+
+    std::string const foo_json = "{ \"f\": [ { \"a\": [ { \"token\": \"hey1\" }, { \"token\": \"hey2\" } ] }, { \"b\": null } ] }";
+    EXPECT_EQ((from_json<foo, registry>(foo_json, dori::json::fields<"f.token">)), (read_json<foo, registry>(foo_json)));
+
+    std::string const sample_json = to_json<sample, registry>(sample{._id = 7, ._big = 1, ._ratio = 0.5, ._scale = 1e-7, ._flag = 'q',
+                                                                     ._text = "text", ._triple = {3, 2, 1}, ._values = {1.0}, ._maybe = 4});
+    auto const partial = from_json<sample, registry>(sample_json, dori::json::fields<"id", "values">);
+    EXPECT_EQ(partial._id, 7);
+    EXPECT_EQ(partial._values, std::vector<double>({1.0}));
+    EXPECT_EQ(partial._big, 0);
+    EXPECT_TRUE(partial._text.empty());
+    EXPECT_FALSE(partial._maybe.has_value());
+
+    EXPECT_THROW((from_json<response, registry>("{\"data\": null}", dori::json::fields<"success">)), nlohmann::json::out_of_range);
+    EXPECT_NO_THROW((from_json<response, registry>("{\"success\": false}", dori::json::fields<"success">)));
+    EXPECT_THROW((from_json<response, registry>("{\"success\": false, \"data\": [}", dori::json::fields<"success">)), nlohmann::json::parse_error);
+    EXPECT_THROW((from_json<response, registry>("{\"success\": false, \"data\": [tru, {\"k\": fals}]}", dori::json::fields<"success">)), nlohmann::json::parse_error);
+    EXPECT_THROW((from_json<response, registry>("{\"unknown\": [1 2], \"success\": false}", dori::json::fields<"success">)), nlohmann::json::parse_error);
+}
+
+TEST(JsonMsgpack, RoundTripsAndMatchesNlohmann)
+{
+    sample const s{._id = -7, ._big = -9007199254740993, ._ratio = 0.1, ._scale = 1e300, ._flag = 'q',
+                   ._text = std::string(40, 'x'), ._triple = {300, -40000, 70000}, ._values = {1.5, -2.0}, ._maybe = std::nullopt};
+    auto const bytes = to_msgpack<sample, registry>(s);
+    EXPECT_EQ(nlohmann::json::from_msgpack(bytes), nlohmann::json::parse(to_json<sample, registry>(s)));
+    EXPECT_EQ((to_json<sample, registry>(from_msgpack<sample, registry>(bytes))), (to_json<sample, registry>(s)));
+
+    auto document = nlohmann::json::parse(to_json<sample, registry>(s));
+    document["extra"] = nlohmann::json::parse(R"({"x": [1, 2.5, "s", null, true, {"y": -1000000}], "z": 18446744073709551615})");
+    EXPECT_EQ((to_json<sample, registry>(from_msgpack<sample, registry>(nlohmann::json::to_msgpack(document)))), (to_json<sample, registry>(s)));
+
+    foo f;
+    f._f["a"] = std::vector<data>{data{"hey1"}, data{std::string(300, 'y')}};
+    f._f["b"] = std::nullopt;
+    EXPECT_EQ((from_msgpack<foo, registry>(to_msgpack<foo, registry>(f))), f);
+    EXPECT_EQ(nlohmann::json::from_msgpack(to_msgpack<foo, registry>(f))["f"]["a"][0]["token"], "hey1");
+
+    foo recycled;
+    recycled._f["stale"] = std::nullopt;
+    read_msgpack_into<foo, registry>(to_msgpack<foo, registry>(f), recycled);
+    EXPECT_EQ(recycled, f);
+
+    numbers const n{._i8 = -128, ._u8 = 255, ._i16 = -32768, ._i32 = 65536, ._i64 = std::numeric_limits<std::int64_t>::min(),
+                    ._u64 = std::numeric_limits<std::uint64_t>::max(), ._f32 = 0.1f, ._f64 = -0.0};
+    auto const decoded = from_msgpack<numbers, registry>(to_msgpack<numbers, registry>(n));
+    EXPECT_EQ((to_json<numbers, registry>(decoded)), (to_json<numbers, registry>(n)));
+
+    std::string appended = "prefix";
+    write_msgpack<data, registry>(data{"borrowed"}, appended);
+    auto const data_bytes = to_msgpack<data, registry>(data{"borrowed"});
+    EXPECT_EQ(appended.substr(6), std::string(data_bytes.begin(), data_bytes.end()));
+
+    auto const view_bytes = to_msgpack<view_data, registry>(view_data{._token = "t", ._raw = std::span<char const>("raw", 3), ._note = "n", ._owned = "o"});
+    auto const views = from_msgpack<view_data, registry>(view_bytes);
+    EXPECT_EQ(views._token, "t");
+    EXPECT_EQ(views._note, "n");
+    EXPECT_EQ(std::string_view(views._raw.data(), views._raw.size()), "raw");
+    EXPECT_GE(reinterpret_cast<std::uint8_t const*>(views._token.data()), view_bytes.data());
+    EXPECT_LT(reinterpret_cast<std::uint8_t const*>(views._token.data()), view_bytes.data() + view_bytes.size());
+
+    EXPECT_THROW((from_msgpack<sample, registry>(std::span(bytes).first(bytes.size() - 1))), nlohmann::json::parse_error);
+    EXPECT_THROW((from_msgpack<data, registry>(nlohmann::json::to_msgpack({{"token", 1}}))), nlohmann::json::type_error);
+    EXPECT_THROW((from_msgpack<data, registry>(nlohmann::json::to_msgpack({{"other", "x"}}))), nlohmann::json::out_of_range);
+    EXPECT_THROW((from_msgpack<numbers, registry>(nlohmann::json::to_msgpack(nlohmann::json::parse(R"({"i8": 128, "u8": 0, "i16": 0, "i32": 0, "i64": 0, "u64": 0, "f32": 0, "f64": 0})")))), nlohmann::json::out_of_range);
+    EXPECT_THROW((from_msgpack<data, registry>(std::vector<std::uint8_t>{0x81, 0xa5, 't', 'o', 'k', 'e', 'n', 0xdc, 0xff, 0xff})), nlohmann::json::type_error);
+}
+
+TEST(JsonMergePatch, DiffThenApply)
+{
+    tick const before{._seq = 1, ._head = {"a"}, ._tail = data{"t"}, ._values = {1, 2}};
+
+    auto check = [&](tick const& after, std::string const& expected_patch) {
+        auto const patch = to_merge_patch<tick, registry>(before, after);
+        EXPECT_EQ(patch, expected_patch);
+
+        auto document = nlohmann::json::parse(to_json<tick, registry>(before));
+        document.merge_patch(nlohmann::json::parse(patch));
+        auto expected = nlohmann::json::parse(to_json<tick, registry>(after));
+        if(expected["tail"].is_null())
+        {
+            expected.erase("tail");// a generic merge patch removes the members patched to null
+        }
+        EXPECT_EQ(document, expected);
+
+        tick patched = before;
+        apply_merge_patch<tick, registry>(patched, patch);
+        EXPECT_EQ((to_json<tick, registry>(patched)), (to_json<tick, registry>(after)));
+    };
+
+    check(before, "{}");
+    check(tick{._seq = 2, ._head = {"a"}, ._tail = data{"t"}, ._values = {1, 2}}, "{\"seq\":2}");
+    check(tick{._seq = 1, ._head = {"b"}, ._tail = std::nullopt, ._values = {1, 2}}, "{\"head\":{\"token\":\"b\"},\"tail\":null}");
+    check(tick{._seq = 1, ._head = {"a"}, ._tail = data{"u"}, ._values = {1}}, "{\"tail\":{\"token\":\"u\"},\"values\":[1]}");
+
+    tick empty_tail = before;
+    empty_tail._tail.reset();
+    auto const refill = to_merge_patch<tick, registry>(empty_tail, before);
+    EXPECT_EQ(refill, "{\"tail\":{\"token\":\"t\"}}");
+    apply_merge_patch<tick, registry>(empty_tail, refill);
+    EXPECT_EQ(empty_tail._tail, before._tail);
+
+    response const old_response{._success = true, ._data = std::map<std::string, data>{{"1", {"x"}}}};
+    response new_response = old_response;
+    new_response._data->at("1")._token = "y";
+    EXPECT_EQ((to_merge_patch<response, registry>(old_response, new_response)), "{\"data\":[{\"1\":{\"token\":\"y\"}}]}");
+
+    tick target = before;
+    apply_merge_patch<tick, registry>(target, "{\"unknown\": [1], \"head\": {}}");
+    EXPECT_EQ((to_json<tick, registry>(target)), (to_json<tick, registry>(before)));
+    EXPECT_THROW((apply_merge_patch<tick, registry>(target, "{\"seq\": \"x\"}")), nlohmann::json::type_error);
+    EXPECT_THROW((apply_merge_patch<tick, registry>(target, "{\"seq\": 1")), nlohmann::json::parse_error);
+}
+
+TEST(JsonSerialization, MapEncodings)
+{
+    catalog const c{._stock = {{"apple", 3}}, ._by_id = {{-2, {"b"}}, {10, {"a"}}}, ._flat = {{"x", 1}, {"y", 2}}};
+
+    auto const pairs = to_json<catalog, registry>(c);
+    EXPECT_EQ(pairs, "{\"by_id\":[{\"-2\":{\"token\":\"b\"}},{\"10\":{\"token\":\"a\"}}],\"flat\":[{\"x\":1},{\"y\":2}],\"stock\":[{\"apple\":3}]}");
+    auto const object = to_json<catalog, registry>(c, {.maps = dori::json::map_encoding::object});
+    EXPECT_EQ(object, "{\"by_id\":{\"-2\":{\"token\":\"b\"},\"10\":{\"token\":\"a\"}},\"flat\":{\"x\":1,\"y\":2},\"stock\":{\"apple\":3}}");
+
+    for(auto const& text : {pairs, object})
+    {
+        for(auto const& decoded : {read_json<catalog, registry>(text), from_json<catalog, registry>(text)})
+        {
+            EXPECT_EQ(decoded._stock, c._stock);
+            EXPECT_EQ(decoded._by_id, c._by_id);
+            EXPECT_EQ(decoded._flat, c._flat);
+        }
+    }
+    EXPECT_EQ((to_json<catalog, registry>(from_msgpack<catalog, registry>(to_msgpack<catalog, registry>(c)))), pairs);
+
+    // entries decode into the recycled containers and flat maps are kept sorted
+    catalog recycled{._stock = {{"stale", 0}}, ._by_id = {{-2, {"old"}}, {5, {"gone"}}}, ._flat = {{"z", 0}}};
+    read_json_into<catalog, registry>("{\"by_id\":{\"10\":{\"token\":\"a\"},\"-2\":{\"token\":\"b\"}},\"flat\":[{\"y\":2},{\"x\":1}],\"stock\":{\"apple\":3}}", recycled);
+    EXPECT_EQ(recycled._stock, c._stock);
+    EXPECT_EQ(recycled._by_id, c._by_id);
+    EXPECT_EQ(recycled._flat, c._flat);
+
+    catalog changed = c;
+    changed._stock["pear"] = 1;
+    EXPECT_EQ((to_merge_patch<catalog, registry>(c, c)), "{}");
+    EXPECT_EQ((to_merge_patch<catalog, registry>(c, changed)).substr(0, 9), "{\"stock\":");
+
+    // only unique-key containers and the opt-in vector_map are maps, a plain vector of pairs is an ordinary vector
+    static_assert(dori::meta::is_map_v<std::map<int, int>> && dori::meta::is_map_v<std::unordered_map<std::string, int>>);
+    static_assert(!dori::meta::is_map_v<std::multimap<int, int>> && !dori::meta::is_map_v<std::unordered_multimap<int, int>>);
+    static_assert(!dori::meta::is_map_v<std::vector<std::pair<std::string, int>>>);
+
+    std::string const bad_key = "{\"by_id\":{\"ten\":{\"token\":\"a\"}},\"flat\":[],\"stock\":{}}";
+    EXPECT_THROW((read_json<catalog, registry>(bad_key)), nlohmann::json::type_error);
+    EXPECT_THROW((from_json<catalog, registry>(bad_key)), nlohmann::json::type_error);
+}
+
+TEST(JsonSerialization, ColumnarVectors)
+{
+    tape const t{._ticks = {tick{._seq = 1, ._head = {"a"}, ._tail = data{"t"}, ._values = {1, 2}},
+                            tick{._seq = 2, ._head = {"b"}, ._tail = std::nullopt, ._values = {}}}};
+    dori::json::write_options const columnar{.arrays = dori::json::array_encoding::columns};
+
+    auto const rows = to_json<tape, registry>(t);
+    auto const columns = to_json<tape, registry>(t, columnar);
+    EXPECT_EQ(columns, "{\"ticks\":{\"head\":[{\"token\":\"a\"},{\"token\":\"b\"}],\"seq\":[1,2],\"tail\":[{\"token\":\"t\"},null],\"values\":[[1,2],[]]}}");
+
+    for(auto const& text : {rows, columns})
+    {
+        EXPECT_EQ((to_json<tape, registry>(read_json<tape, registry>(text))), rows);
+        EXPECT_EQ((to_json<tape, registry>(from_json<tape, registry>(text))), rows);
+    }
+
+    foo f;
+    f._f["a"] = std::vector<data>{data{"hey1"}, data{"hey2"}};
+    f._f["b"] = std::nullopt;
+    EXPECT_EQ((to_json<foo, registry>(f, columnar)), "{\"f\":[{\"a\":{\"token\":[\"hey1\",\"hey2\"]}},{\"b\":null}]}");
+    EXPECT_EQ((read_json<foo, registry>(to_json<foo, registry>(f, columnar))), f);
+
+    // rows are overwritten in place and the leftovers dropped
+    tape recycled{._ticks = std::vector<tick>(5, tick{._seq = 9, ._head = {"stale"}, ._tail = data{"stale"}, ._values = {9}})};
+    read_json_into<tape, registry>(columns, recycled);
+    EXPECT_EQ((to_json<tape, registry>(recycled)), rows);
+    read_json_into<tape, registry>("{\"ticks\":{\"head\":[],\"seq\":[],\"tail\":[],\"values\":[]}}", recycled);
+    EXPECT_TRUE(recycled._ticks.empty());
+
+    auto const projected = from_json<tape, registry>(columns, dori::json::fields<"ticks.seq">);
+    ASSERT_EQ(projected._ticks.size(), 2u);
+    EXPECT_EQ(projected._ticks[1]._seq, 2);
+    EXPECT_EQ(projected._ticks[1]._head._token, "");
+
+    std::string const uneven = "{\"ticks\":{\"head\":[{\"token\":\"a\"}],\"seq\":[1,2],\"tail\":[null],\"values\":[[]]}}";
+    EXPECT_THROW((read_json<tape, registry>(uneven)), nlohmann::json::type_error);
+    EXPECT_THROW((from_json<tape, registry>(uneven)), nlohmann::json::type_error);
+    auto const error = try_from_json<tape, registry>(uneven);
+    ASSERT_FALSE(error.has_value());
+    EXPECT_EQ(error.error().path, "/ticks/seq");
+
+    std::string const missing = "{\"ticks\":{\"head\":[{\"token\":\"a\"}],\"seq\":[1],\"values\":[[]]}}";
+    EXPECT_THROW((read_json<tape, registry>(missing)), nlohmann::json::out_of_range);
+    EXPECT_THROW((from_json<tape, registry>(missing)), nlohmann::json::out_of_range);
+}
+
+TEST(JsonSerialization, SerializedSizeIsExact)
+{
+    // every writer path, in both text formats: the predicted size is the written size, and the dom format is nlohmann's
+    auto const check = []<typename T>(T const& value, dori::json::write_options const options = {}) {
+        for(auto const format : {dori::json::text_format::native, dori::json::text_format::dom})
+        {
+            auto with_format = options;
+            with_format.format = format;
+            std::string written;
+            write_json<T, registry>(value, written, with_format);
+            EXPECT_EQ((serialized_size<T, registry>(value, with_format)), written.size());
+            EXPECT_EQ((to_json<T, registry>(value, with_format)), written);
+            if(format == dori::json::text_format::dom)
+            {
+                EXPECT_EQ(nlohmann::json::parse(written).dump(), written);
+            }
+        }
+    };
+
+    check(sample{._id = std::numeric_limits<int>::min(), ._big = -9007199254740993, ._ratio = 0.1, ._scale = std::numeric_limits<double>::infinity(),
+                 ._flag = 'x', ._text = "quote\" backslash\\ tab\t bell\x07 nul" + std::string(1, '\0') + " utf8 \xc3\xa9" + std::string(100, 'z'),
+                 ._triple = {0, 9, -10}, ._values = {1.0, -0.0, 123456.789, 1e-7, 1.5e300, std::nan("")}, ._maybe = 2.5});
+    check(numbers{._i8 = -128, ._u8 = 255, ._i16 = -32768, ._i32 = 2147483647, ._i64 = std::numeric_limits<std::int64_t>::min(),
+                  ._u64 = std::numeric_limits<std::uint64_t>::max(), ._f32 = 0.1f, ._f64 = 1e-300});
+    check(numbers{0, 0, 0, 0, 0, 0, std::numeric_limits<float>::max(), std::numeric_limits<double>::denorm_min()});
+    check(numbers{0, 0, 0, 0, 0, 0, std::numeric_limits<float>::denorm_min(), -0.0});
+    check(numbers{0, 0, 0, 0, 0, 0, std::numeric_limits<float>::quiet_NaN(), 1.0 / 3});
+    check(response{._success = false, ._data = std::nullopt});
+    check(view_data{._token = "t\"", ._raw = std::span<char const>("raw", 3), ._note = std::nullopt, ._owned = ""});
+
+    catalog const c{._stock = {{"apple", 3}}, ._by_id = {{-2, {"b"}}, {10, {"a"}}}, ._flat = {{"x\n", 1}}};
+    check(c);
+    check(c, {.maps = dori::json::map_encoding::object});
+
+    tape const t{._ticks = {tick{._seq = 1, ._head = {"a"}, ._tail = data{"t"}, ._values = {1, 2}}, tick{._seq = -2, ._head = {""}, ._tail = std::nullopt, ._values = {}}}};
+    check(t);
+    check(t, {.arrays = dori::json::array_encoding::columns});
+    check(tape{});
+
+    std::string const json = "{\"data\": [ {\"1\": {\"token\": \"a \\u00e9\"}} ] ,\"route\":\"users\"}";
+    auto decoded = read_json<routed, registry>(json);
+    check(decoded);
+    check(decoded, {.maps = dori::json::map_encoding::object});
+    ASSERT_TRUE(decoded._data->has_value());
+    check(decoded);
+    check(routed{._route = "r", ._data = {}});
+
+    std::pmr::monotonic_buffer_resource arena;
+    auto const pmr = from_json<pmr_foo, registry>(std::string_view("{\"f\":[{\"a\":[{\"token\":\"x\\ny\"}]},{\"b\":null}]}"), &arena);
+    check(pmr);
+    check(pmr, {.maps = dori::json::map_encoding::object});
+}
+
+TEST(JsonSerialization, TextFormats)
+{
+    numbers const n{0, 0, 0, 0, 0, 0, 0.1f, 0.1};
+    std::string native;
+    write_json<numbers, registry>(n, native);
+    EXPECT_NE(native.find("\"f32\":0.1,"), std::string::npos);
+
+    // to_json keeps the text of nlohmann::json, floats through their double widening
+    auto const dom = to_json<numbers, registry>(n);
+    EXPECT_NE(dom.find("\"f32\":0.10000000149011612,"), std::string::npos);
+    EXPECT_EQ(dom, (to_json<numbers, registry>(n, {.format = dori::json::text_format::dom})));
+    EXPECT_EQ(native, (to_json<numbers, registry>(n, {})));
+
+    // raw lazy members are copied verbatim by the native format and normalized by the dom one
+    std::string const json = "{\"data\": [ {\"1\" : {\"token\": \"a\"}} ],\"route\":\"users\"}";
+    auto const decoded = read_json<routed, registry>(json);
+    std::string verbatim;
+    write_json<routed, registry>(decoded, verbatim);
+    EXPECT_EQ(verbatim, "{\"data\":[ {\"1\" : {\"token\": \"a\"}} ],\"route\":\"users\"}");
+    EXPECT_EQ((to_json<routed, registry>(decoded)), nlohmann::json::parse(json).dump());
+    EXPECT_EQ((serialized_size<routed, registry>(decoded)), verbatim.size());
+
+    // the dom format rejects what dump() rejects, with its message, the native one writes the bytes through
+    for(std::string const invalid : {"a\xff", "\xc3(", "\xe0\x80\x80", "\xed\xa0\x80", "\xf4\x90\x80\x80", "ok \xe2\x82"})
+    {
+        data const d{invalid};
+        std::string expected;
+        try
+        {
+            (void)nlohmann::json(invalid).dump();
+        }
+        catch(nlohmann::json::type_error const& e)
+        {
+            expected = e.what();
+        }
+        ASSERT_FALSE(expected.empty()) << invalid;
+        try
+        {
+            (void)to_json<data, registry>(d);
+            ADD_FAILURE() << invalid;
+        }
+        catch(nlohmann::json::type_error const& e)
+        {
+            EXPECT_EQ(std::string(e.what()), expected);
+        }
+        EXPECT_THROW((serialized_size<data, registry>(d, {.format = dori::json::text_format::dom})), nlohmann::json::type_error);
+
+        std::string written;
+        write_json<data, registry>(d, written);
+        EXPECT_EQ(written, "{\"token\":\"" + invalid + "\"}");
+    }
+    EXPECT_EQ((to_json<data, registry>(data{"\xc3\xa9 \xf0\x9f\x98\x80 \xef\xbf\xbf"})), "{\"token\":\"\xc3\xa9 \xf0\x9f\x98\x80 \xef\xbf\xbf\"}");
+}